@@ -0,0 +1,116 @@
+#include "BinIndex.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+static constexpr unsigned long long length_scale{ 10000000000ULL };	// 10^Card::span_digits, keys are length * length_scale + number.
+
+/**
+ * @brief Compiles the index of a catalog.
+ *
+ * Every span is turned into a start and an end event, the events are sorted once and swept
+ * with the set of spans that cover the current number, ordered by width. A new segment
+ * starts wherever the narrowest covering span changes its issuer. Building takes
+ * O(n log n) in the number of ranges.
+ *
+ * @param catalog The catalog.
+ */
+void BinIndex::build(const Catalog& catalog)
+{
+	// a span starts (or ends after) key, owner is the index of its card
+	struct Event
+	{
+		unsigned long long key{};
+		bool start{};
+		unsigned long long width{};
+		size_t owner{};
+	};
+
+	m_starts.clear();
+	m_owners.clear();
+	m_issuers.clear();
+
+	// the issuers are already interned by the catalog
+	for (uint32_t id{}; id < catalog.issuer_count(); id++)
+	{
+		m_issuers.emplace_back(catalog.issuer_name(id));
+	}
+
+	std::vector<Event> events{};
+	std::vector<Card::Span> spans{};
+	for (size_t i{}; i < catalog.size(); i++)
+	{
+		spans.clear();
+		for (const auto& range : catalog.ranges(i))
+		{
+			Card::split_range(range, spans);
+		}
+		unsigned long long base{ static_cast<unsigned long long>(catalog.length(i)) * length_scale };
+		for (const auto& span : spans)
+		{
+			events.push_back(Event{ base + span.lo, true, span.hi - span.lo, i });
+			events.push_back(Event{ base + span.hi + 1, false, span.hi - span.lo, i });
+		}
+	}
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.key < b.key; });
+
+	std::multiset<std::pair<unsigned long long, size_t>> covering{};
+	int owner{ -1 };
+	for (size_t i{}; i < events.size();)
+	{
+		unsigned long long key{ events[i].key };
+		for (; i < events.size() && events[i].key == key; i++)
+		{
+			std::pair<unsigned long long, size_t> span{ events[i].width, events[i].owner };
+			if (events[i].start)
+			{
+				covering.insert(span);
+			}
+			else
+			{
+				covering.erase(covering.find(span));
+			}
+		}
+
+		int next_owner{ covering.empty() ? -1 : static_cast<int>(catalog.issuer_id(covering.begin()->second)) };
+		if (next_owner != owner)
+		{
+			m_starts.push_back(key);
+			m_owners.push_back(next_owner);
+			owner = next_owner;
+		}
+	}
+}
+
+/**
+ * @brief Looks up the issuer of a card number.
+ *
+ * Only ranges of cards with as many digits as number match. Numbers shorter than
+ * Card::span_digits are padded with zeros, which can't change the result since a prefix
+ * is always shorter than its card.
+ *
+ * @param number The card number, digits only.
+ * @return The issuer, nullptr if there is none.
+ */
+const std::string* BinIndex::find(std::string_view number) const
+{
+	if (number.empty() || number.size() > 32 || number.find_first_not_of("0123456789") != std::string_view::npos)
+	{
+		return nullptr;
+	}
+
+	unsigned long long key{};
+	for (size_t i{}; i < static_cast<size_t>(Card::span_digits); i++)
+	{
+		key = key * 10 + (i < number.size() ? number[i] - '0' : 0);
+	}
+	key += number.size() * length_scale;
+
+	auto it = std::upper_bound(m_starts.begin(), m_starts.end(), key);
+	if (it == m_starts.begin())
+	{
+		return nullptr;
+	}
+	int owner{ m_owners[it - m_starts.begin() - 1] };
+	return owner < 0 ? nullptr : &m_issuers[owner];
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Catalog.h"
+
+/**
+ * @class BinIndex
+ * @brief Finds the issuer of a card number, compiled from the ranges of a catalog.
+ *
+ * The spans of every range (see Card::split_range) are cut into disjoint segments of card
+ * numbers, keyed by card length and the first Card::span_digits digits. Where ranges of
+ * several cards overlap a segment belongs to the narrowest one, i.e. the longest matching
+ * prefix. A lookup is a binary search over the segment starts.
+ */
+class BinIndex
+{
+public:
+	// Compiles the index of a catalog, replacing the previous one.
+	void build(const Catalog& catalog);
+
+	// Returns the issuer of number, nullptr if it isn't a string of digits or no range of its length matches.
+	const std::string* find(std::string_view number) const;
+
+	// Number of segments of the index.
+	size_t size() const { return m_starts.size(); }
+
+private:
+	std::vector<unsigned long long> m_starts{};	// First key of every segment, ascending.
+	std::vector<int> m_owners{};				// Issuer of every segment, -1 for none.
+	std::vector<std::string> m_issuers{};		// Interned issuer names.
+};
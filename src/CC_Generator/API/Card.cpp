@@ -1,4 +1,6 @@
 #include "Card.h"
+#include <limits>
+#include <algorithm>
 
 std::mt19937 Card::m_rng{ std::random_device{}() };
 
@@ -6,7 +8,7 @@ std::mt19937 Card::m_rng{ std::random_device{}() };
  * @brief Parses a string representing numeric ranges and populates the Card object.
  *
  * This function takes a string containing comma-separated numeric ranges and parses
- * them, populating the Card object with the extracted ranges.
+ * them, replacing the ranges of the Card object with the extracted ones.
  *
  * The input string should have the format "start-end,start-end,..." where start and
  * end are integers defining a numeric range. If a single number is provided without
@@ -14,31 +16,14 @@ std::mt19937 Card::m_rng{ std::random_device{}() };
  *
  * @param ranges_str A string containing comma-separated numeric ranges.
  *
- * @note The function assumes a valid input format. No input validation is performed.
+ * @note The length of the card is not checked, use validate_prefix() for that. Parsing
+ *       stops at the first invalid token, the ranges before it are kept.
  *
- * @see Card
+ * @see parse_prefixes
  */
 void Card::parse_ranges(const std::string& ranges_str)
 {
-	std::istringstream iss(ranges_str);
-	std::string range_token;
-	while (std::getline(iss, range_token, ','))
-	{
-		std::istringstream range_stream(range_token);
-		int start, end;
-		char dash;
-		range_stream >> start;
-		if (range_stream >> dash >> end)
-		{
-			// range case
-			m_ranges.emplace_back(start, end);
-		}
-		else
-		{
-			// single number case
-			m_ranges.emplace_back(start, start);
-		}
-	}
+	Card::parse_prefixes(ranges_str, std::numeric_limits<int>::max(), m_ranges);
 }
 
 /**
@@ -60,31 +45,85 @@ void Card::parse_ranges(const std::string& ranges_str)
  * @see parse_ranges()
  */
 void Card::generate_card(std::ostringstream& oss) const
+{
+	std::string rnd_card{};
+	generate_card(rnd_card, m_rng);
+	oss << rnd_card << "\n";
+}
+
+/**
+ * @brief Generates a random card number using a caller supplied random number generator.
+ *
+ * Works like generate_card(std::ostringstream&) but draws every random value from rng,
+ * so callers that seed their own generator get a reproducible sequence of cards.
+ * The digits are appended to out without a trailing newline.
+ *
+ * @param out The string to which the generated card number is appended.
+ * @param rng The random number generator to draw from.
+ *
+ * @see generate_card(std::ostringstream&)
+ */
+void Card::generate_card(std::string& out, std::mt19937& rng) const
+{
+	generate_number(m_ranges.data(), m_ranges.size(), m_len, out, rng);
+}
+
+/**
+ * @brief Generates a random card number from prefix ranges.
+ *
+ * A range is drawn, then a prefix within it, then the digits up to len - 1 and the Luhn check
+ * digit. Card and Catalog both generate through this function, so they draw the same numbers
+ * from the same generator.
+ *
+ * @param ranges The prefix ranges, count of them one after the other.
+ * @param count The number of ranges, at least one.
+ * @param len The length of the card number.
+ * @param out The string to which the generated card number is appended.
+ * @param rng The random number generator to draw from.
+ */
+void Card::generate_number(const std::pair<int, int>* ranges, size_t count, int len, std::string& out, std::mt19937& rng)
 {
 	// Randomly select a range
-	std::uniform_int_distribution<int> range_dist(0, m_ranges.size() - 1);
-	const auto& range = m_ranges[range_dist(m_rng)];
+	std::uniform_int_distribution<int> range_dist(0, static_cast<int>(count) - 1);
+	const auto& range = ranges[range_dist(rng)];
 
 	// Generate a random number within the selected range
 	std::uniform_int_distribution<int> num_dist(range.first, range.second);
-	int prefix{ num_dist(m_rng) };
+	int prefix{ num_dist(rng) };
 
 	// Generate a random card
-	std::string rnd_card{ std::to_string(prefix) };
+	size_t begin{ out.size() };
+	out += std::to_string(prefix);
 	std::uniform_int_distribution<int> dis(0, 9);
 
-	for (int i = rnd_card.size(); i < m_len - 1; i++)
+	for (int i = static_cast<int>(out.size() - begin); i < len - 1; i++)
 	{
-		rnd_card += std::to_string(dis(m_rng));
+		out += static_cast<char>('0' + dis(rng));
 	}
 
 	// Apply Luhn's algorithm to generate the last digit
+	out += static_cast<char>('0' + luhn_digit(std::string_view(out).substr(begin, len - 1)));
+}
+
+/**
+ * @brief Calculates the Luhn check digit of a string of digits.
+ *
+ * Every second digit, starting from the rightmost one, is doubled (subtracting 9 when the
+ * result has two digits) and the check digit brings the sum to a multiple of 10.
+ *
+ * @param digits The digits the check digit is appended to, without the check digit.
+ * @return The check digit, 0-9.
+ *
+ * @note Every character of digits must be a digit.
+ */
+int Card::luhn_digit(std::string_view digits)
+{
 	int sum{ 0 };
 	bool double_digit{ true };
 
-	for (int i{ m_len - 2 }; i >= 0; i--)
+	for (size_t i{ digits.size() }; i-- > 0;)
 	{
-		int digit = rnd_card[i] - '0';
+		int digit = digits[i] - '0';
 
 		if (double_digit && (digit *= 2) >= 10)
 		{
@@ -96,8 +135,22 @@ void Card::generate_card(std::ostringstream& oss) const
 	}
 
 	// Calculate the last digit to make the entire number valid
-	rnd_card += std::to_string((10 - (sum % 10)) % 10);
-	oss << rnd_card << "\n";
+	return (10 - (sum % 10)) % 10;
+}
+
+/**
+ * @brief Validates a card number with Luhn's algorithm.
+ *
+ * @param number The card number, including the check digit.
+ * @return true if the number has at least two characters, all of them digits, and a correct check digit, false otherwise.
+ */
+bool Card::luhn_valid(std::string_view number)
+{
+	if (number.size() < 2 || number.find_first_not_of("0123456789") != std::string_view::npos)
+	{
+		return false;
+	}
+	return luhn_digit(number.substr(0, number.size() - 1)) == number.back() - '0';
 }
 
 /**
@@ -129,76 +182,126 @@ bool Card::validate_issuer(const std::string& issuer)
  *
  * @param prefix The comma-separated string of numeric prefixes to be validated.
  * @param len The maximum length that a valid prefix can have.
+ * @param error Receives the position and the reason if the prefixes are invalid, may be nullptr.
  * @return true if the input string conforms to the specified rules, false otherwise.
  *
- * @details This function takes a comma-separated string of numeric prefixes and validates each token
- * separately. It checks if each token is a valid positive integer or a valid numeric range with a
- * start value less than or equal to the end value. It also ensures that the length of the prefix does
- * not exceed the specified maximum length.
+ * @see parse_prefixes
+ */
+bool Card::validate_prefix(std::string_view prefix, int len, PrefixError* error)
+{
+	std::vector<std::pair<int, int>> ranges{};
+	return Card::parse_prefixes(prefix, len, ranges, error);
+}
+
+/**
+ * @brief Parses and validates a comma-separated string of numeric prefixes in a single pass.
+ *
+ * Every token, optionally surrounded by spaces, is a positive number or an increasing
+ * "start-end" range whose numbers have no more digits than the card number (leading zeros
+ * of a single number count, those of a range don't). Numbers that don't fit in an int are
+ * rejected as well.
  *
+ * The characters are scanned once without regular expressions or temporary strings, the
+ * ranges are emitted as they are read. This is the parser behind validate_prefix(),
+ * parse_ranges(), the add-card forms and Importer.
+ *
+ * @param prefixes The prefixes, e.g. "4" or "51-55,2221-2720".
+ * @param len The length of the card number.
+ * @param ranges Receives the parsed ranges, cleared first.
+ * @param error Receives the offset of the offending character (or token) and the reason
+ *              on failure, may be nullptr.
+ * @return true if the whole string is valid, false otherwise.
  */
-bool Card::validate_prefix(const std::string& prefix, int len)
+bool Card::parse_prefixes(std::string_view prefixes, int len, std::vector<std::pair<int, int>>& ranges, PrefixError* error)
 {
-	if (prefix.empty())
-	{
-		return false;
-	}
-	if (prefix[prefix.size() - 1] == ',')
+	ranges.clear();
+	size_t pos{};
+	const size_t size{ prefixes.size() };
+
+	auto fail = [&](size_t position, const char* message)
 	{
+		if (error != nullptr)
+		{
+			error->position = position;
+			error->message = message;
+		}
 		return false;
-	}
-
-	std::stringstream ss(prefix);
-	std::string token;
+	};
 
-	while (std::getline(ss, token, ','))
+	// reads a number at pos, digits receives its length (without leading zeros if significant is set)
+	auto read_number = [&](long long& value, int& digits, bool significant) -> const char*
 	{
-		size_t start{ token.find_first_not_of(" ") };
-		size_t end{ token.find_last_not_of(" ") };
-
-		// if it's empty return false
-		if (start == std::string::npos || end == std::string::npos)
+		value = 0;
+		digits = 0;
+		const size_t begin{ pos };
+		for (; pos < size && prefixes[pos] >= '0' && prefixes[pos] <= '9'; pos++)
 		{
-			return false;
+			value = value * 10 + (prefixes[pos] - '0');
+			digits += significant == false || value > 0;
+			if (value > std::numeric_limits<int>::max())
+			{
+				pos = begin;
+				return "number too large";
+			}
 		}
+		return pos == begin ? "expected a digit" : nullptr;
+	};
 
-		token = token.substr(start, end - start + 1);
+	while (true)
+	{
+		while (pos < size && prefixes[pos] == ' ')
+		{
+			pos++;
+		}
 
-		// range
-		if (std::regex_match(token, std::regex(R"(\d+\-\d+)")))
+		const size_t token{ pos };
+		long long start{};
+		long long stop{};
+		int start_digits{};
+		int stop_digits{};
+		if (const char* message{ read_number(start, start_digits, false) })
 		{
-			std::istringstream iss(token);
-			int start, end;
-			char dash;
-			iss >> start >> dash >> end;
-			// Range is not in increasing order
-			if (end < start)
+			return fail(pos, message);
+		}
+		stop = start;
+		stop_digits = start_digits;
+		if (pos < size && prefixes[pos] == '-')
+		{
+			pos++;
+			if (const char* message{ read_number(stop, stop_digits, true) })
 			{
-				return false;
+				return fail(pos, message);
 			}
-			// the prefix is larger than the length		
-			if (std::to_string(start).length() > len || std::to_string(end).length() > len || start == 0)
+			if (stop < start)
 			{
-				return false;
+				return fail(token, "range is not increasing");
 			}
+			start_digits = static_cast<int>(std::to_string(start).size());
 		}
-		// digit
-		else if (std::regex_match(token, std::regex(R"(\d+)")))
+		if (start == 0)
 		{
-			// the prefix is larger than the length	or it's zero
-			if (token.size() > len || std::stoi(token.c_str()) == 0)
-			{
-				return false;
-			}
+			return fail(token, "prefix is zero");
 		}
-		// NaN or negative number
-		else
+		if (start_digits > len || stop_digits > len)
 		{
-			return false;
+			return fail(token, "prefix is longer than the card");
 		}
-	}
+		ranges.emplace_back(static_cast<int>(start), static_cast<int>(stop));
 
-	return true;
+		while (pos < size && prefixes[pos] == ' ')
+		{
+			pos++;
+		}
+		if (pos == size)
+		{
+			return true;
+		}
+		if (prefixes[pos] != ',')
+		{
+			return fail(pos, "expected ','");
+		}
+		pos++;
+	}
 }
 
 /**
@@ -216,6 +319,95 @@ bool Card::validate_length(int len)
 	return len >= 2 && len <= 32;
 }
 
+/**
+ * @brief Validates parsed prefix ranges of a credit card.
+ *
+ * Applies the rules of validate_prefix() to ranges that were already parsed, e.g. loaded
+ * from the database as integers: there is at least one range, every range is in increasing
+ * order, starts above zero and its end has no more digits than the card number.
+ *
+ * @param ranges The prefix ranges to be validated.
+ * @param len The length of the card number.
+ * @return true if every range is valid, false otherwise.
+ */
+bool Card::validate_ranges(const std::vector<std::pair<int, int>>& ranges, int len)
+{
+	if (ranges.empty())
+	{
+		return false;
+	}
+
+	for (const auto& range : ranges)
+	{
+		if (range.first <= 0 || range.second < range.first || std::to_string(range.second).length() > static_cast<size_t>(len))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Formats prefix ranges as a comma-separated prefixes string.
+ *
+ * A range with equal start and end is written as a single number, the result is
+ * accepted by validate_prefix() and parse_ranges().
+ *
+ * @param ranges The prefix ranges to format.
+ * @return The prefixes string, e.g. "4" or "51-55,2221-2720".
+ */
+std::string Card::format_ranges(const std::vector<std::pair<int, int>>& ranges)
+{
+	std::string prefixes{};
+	for (const auto& range : ranges)
+	{
+		if (prefixes.empty() == false)
+		{
+			prefixes += ',';
+		}
+		prefixes += std::to_string(range.first);
+		if (range.second != range.first)
+		{
+			prefixes += '-' + std::to_string(range.second);
+		}
+	}
+	return prefixes;
+}
+
+/**
+ * @brief Splits a prefix range into spans of prefixes with the same number of digits.
+ *
+ * A prefix stands for every card number that starts with it, the bounds of a span are the
+ * covered numbers cut to span_digits digits, e.g. "4" covers 4000000000-4999999999 and
+ * "51-55" covers 5100000000-5599999999. Spans of prefixes of different lengths can then be
+ * compared for containment and overlap.
+ *
+ * @param range The prefix range, e.g. 4-49 is split into 4-9 and 10-49.
+ * @param spans The vector to append the spans to.
+ */
+void Card::split_range(const std::pair<int, int>& range, std::vector<Span>& spans)
+{
+	static constexpr unsigned long long pow10[]{ 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+		10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL };
+
+	long long first{ std::max(range.first, 1) };
+	while (first <= range.second)
+	{
+		int digits{ static_cast<int>(std::to_string(first).size()) };
+		long long last{ std::min(static_cast<long long>(range.second), static_cast<long long>(pow10[digits]) - 1) };
+		unsigned long long scale{ pow10[span_digits - digits] };
+
+		Span span{};
+		span.first = static_cast<int>(first);
+		span.last = static_cast<int>(last);
+		span.digits = digits;
+		span.lo = static_cast<unsigned long long>(first) * scale;
+		span.hi = static_cast<unsigned long long>(last + 1) * scale - 1;
+		spans.push_back(span);
+		first = last + 1;
+	}
+}
+
 /**
  * @brief Validates a credit card based on issuer, length, and prefixes.
  *
@@ -2,8 +2,8 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <random>
-#include <regex>
 
 /**
  * @class Card
@@ -26,15 +26,24 @@ public:
 	 */
 	Card(const std::string& issuer, int len, const std::string& prefixes) : m_issuer{ issuer }, m_len{ len }, m_prefixes{ prefixes } { parse_ranges(prefixes); }
 
+	/**
+	 * @brief Constructor from already parsed ranges, the prefixes string is formatted from them.
+	 * @param issuer The issuer of the card.
+	 * @param len The length of the card number.
+	 * @param ranges The numeric prefix ranges associated with the card.
+	 */
+	Card(const std::string& issuer, int len, std::vector<std::pair<int, int>> ranges) : m_issuer{ issuer }, m_len{ len }, m_prefixes{ format_ranges(ranges) }, m_ranges{ std::move(ranges) } {}
+
 	// getters
-	const std::string get_issuer() const { return m_issuer; }
-	const int get_len() const { return m_len; }
-	const std::string get_prefixes() const { return m_prefixes; }
+	const std::string& get_issuer() const { return m_issuer; }
+	int get_len() const { return m_len; }
+	const std::string& get_prefixes() const { return m_prefixes; }
+	const std::vector<std::pair<int, int>>& get_ranges() const { return m_ranges; }
 
 	// setters
 	void set_issuer(const std::string& issuer) { m_issuer = issuer; }
 	void set_len(int len) { m_len = len; }
-	void set_prefixes(const std::string& prefixes) { m_prefixes = prefixes; }
+	void set_prefixes(const std::string& prefixes) { m_prefixes = prefixes; parse_ranges(prefixes); }
 
 	// other methods
 	bool empty() const { return m_issuer.empty() || m_prefixes.empty() || m_len == 0; }
@@ -51,18 +60,61 @@ public:
 	// Appends the generated card number to the provided std::ostringstream.
 	void generate_card(std::ostringstream& oss) const;
 
+	// Generates a random card number using the given generator and appends it (without a newline) to out.
+	void generate_card(std::string& out, std::mt19937& rng) const;
+
 	// Validates a credit card based on issuer, length, and prefixes.
 	static bool validate_card(const std::string& issuer, int length, const std::string& prefixes);
 
 	// Validates the issuer of a credit card.
 	static bool validate_issuer(const std::string& issuer);
 
+	// Where and why a prefixes string is invalid.
+	struct PrefixError
+	{
+		size_t position{};			// Offset of the offending character or token.
+		const char* message{ "" };	// What is wrong there.
+	};
+
 	// Validates the prefix of a credit card based on its length.
-	static bool validate_prefix(const std::string& prefix, int len);
+	static bool validate_prefix(std::string_view prefix, int len, PrefixError* error = nullptr);
 
 	// Validates the length of a credit card number.
 	static bool validate_length(int len);
 
+	// Parses and validates prefixes into ranges in a single pass, error receives the position and the reason on failure.
+	static bool parse_prefixes(std::string_view prefixes, int len, std::vector<std::pair<int, int>>& ranges, PrefixError* error = nullptr);
+
+	// Validates parsed prefix ranges of a credit card based on its length.
+	static bool validate_ranges(const std::vector<std::pair<int, int>>& ranges, int len);
+
+	// Formats prefix ranges as a prefixes string, e.g. "51-55,2221-2720".
+	static std::string format_ranges(const std::vector<std::pair<int, int>>& ranges);
+
+	// The card numbers covered by the prefixes of a range that have the same number of digits.
+	struct Span
+	{
+		int first{};				// The prefixes of the span.
+		int last{};
+		int digits{};				// Digits of every prefix in the span.
+		unsigned long long lo{};	// First covered number, cut to span_digits digits.
+		unsigned long long hi{};	// Last covered number, cut to span_digits digits.
+	};
+
+	static constexpr int span_digits{ 10 };	// Digits of the largest prefix, INT_MAX.
+
+	// Splits a prefix range into spans, e.g. 4-49 into 4-9 and 10-49, and appends them to spans.
+	static void split_range(const std::pair<int, int>& range, std::vector<Span>& spans);
+
+	// Generates a random number of len digits with a prefix from one of the count ranges and appends it to out.
+	static void generate_number(const std::pair<int, int>* ranges, size_t count, int len, std::string& out, std::mt19937& rng);
+
+	// Returns the Luhn check digit of a string of digits.
+	static int luhn_digit(std::string_view digits);
+
+	// Validates a card number with Luhn's algorithm.
+	static bool luhn_valid(std::string_view number);
+
 private:
 	std::string m_issuer{};							// The issuer of the card.
 	int m_len{};									// The length of the card number.
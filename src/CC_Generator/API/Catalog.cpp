@@ -0,0 +1,92 @@
+#include "Catalog.h"
+#include <unordered_map>
+
+/**
+ * @brief Compiles a list of cards into a catalog.
+ *
+ * Every array is sized up front, so compiling a million ranges makes a handful of
+ * allocations. Issuer names are interned in order of first appearance.
+ *
+ * @param cards The cards, e.g. as read by DB_API::read_cards.
+ * @return The catalog, card i of it is cards[i].
+ */
+std::shared_ptr<const Catalog> Catalog::compile(const std::vector<Card>& cards)
+{
+	std::shared_ptr<Catalog> catalog{ new Catalog() };
+	size_t prefixes_size{};
+	size_t ranges_size{};
+	for (const Card& card : cards)
+	{
+		prefixes_size += card.get_prefixes().size();
+		ranges_size += card.get_ranges().size();
+	}
+
+	catalog->m_issuer_ids.reserve(cards.size());
+	catalog->m_lengths.reserve(cards.size());
+	catalog->m_prefixes.reserve(prefixes_size);
+	catalog->m_prefix_offsets.reserve(cards.size() + 1);
+	catalog->m_ranges.reserve(ranges_size);
+	catalog->m_range_offsets.reserve(cards.size() + 1);
+
+	std::unordered_map<std::string_view, uint32_t> ids{};
+	for (const Card& card : cards)
+	{
+		auto it = ids.find(card.get_issuer());
+		if (it == ids.end())
+		{
+			// the key views the caller's string, it's only used while cards is alive
+			it = ids.emplace(card.get_issuer(), static_cast<uint32_t>(catalog->issuer_count())).first;
+			catalog->m_names += card.get_issuer();
+			catalog->m_name_offsets.push_back(static_cast<uint32_t>(catalog->m_names.size()));
+		}
+		catalog->m_issuer_ids.push_back(it->second);
+		catalog->m_lengths.push_back(card.get_len());
+
+		catalog->m_prefixes += card.get_prefixes();
+		catalog->m_prefix_offsets.push_back(static_cast<uint32_t>(catalog->m_prefixes.size()));
+
+		catalog->m_ranges.insert(catalog->m_ranges.end(), card.get_ranges().begin(), card.get_ranges().end());
+		catalog->m_range_offsets.push_back(static_cast<uint32_t>(catalog->m_ranges.size()));
+	}
+	return catalog;
+}
+
+/**
+ * @brief Copies card i out of the catalog, for the editors that work on a list of cards.
+ */
+Card Catalog::card(size_t i) const
+{
+	return Card{ std::string(issuer(i)), length(i), std::string(prefixes(i)) };
+}
+
+/**
+ * @brief Adds up the capacity of every array of the catalog.
+ */
+size_t Catalog::memory_bytes() const
+{
+	return sizeof(Catalog) + m_names.capacity() + m_prefixes.capacity()
+		+ (m_name_offsets.capacity() + m_issuer_ids.capacity() + m_prefix_offsets.capacity() + m_range_offsets.capacity()) * sizeof(uint32_t)
+		+ m_lengths.capacity() * sizeof(int) + m_ranges.capacity() * sizeof(Range);
+}
+
+/**
+ * @brief Compiles a new version of the catalog and makes it the current one.
+ *
+ * @param cards The edited cards.
+ * @return The published snapshot.
+ */
+std::shared_ptr<const Catalog> CatalogStore::publish(const std::vector<Card>& cards)
+{
+	std::shared_ptr<const Catalog> catalog{ Catalog::compile(cards) };
+	publish(catalog);
+	return catalog;
+}
+
+/**
+ * @brief Makes catalog the current snapshot, the jobs holding the previous one keep it.
+ */
+void CatalogStore::publish(std::shared_ptr<const Catalog> catalog)
+{
+	std::atomic_store(&m_current, std::move(catalog));
+	m_version++;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Card.h"
+
+/**
+ * @class Catalog
+ * @brief An immutable, compiled copy of a list of cards, laid out for reading.
+ *
+ * A Card keeps its own issuer string, prefixes string and vector of ranges, so a catalog of a
+ * million ranges is scattered over the heap. A Catalog stores the same cards as a few flat
+ * arrays: the issuer names once each in a text pool (cards of the same issuer share an id), the
+ * prefixes texts one after the other, the ranges of every card in a single array with an offset
+ * per card, and the lengths in their own array. The accessors return views into those arrays
+ * and copy nothing.
+ *
+ * A catalog never changes once compiled and is passed around as a shared_ptr<const Catalog>:
+ * export threads, sinks and the ccgen table keep the snapshot they started with, and handing
+ * one over costs a reference count.
+ */
+class Catalog
+{
+public:
+	using Range = std::pair<int, int>;
+
+	// The ranges of one card, a view into the range array of the catalog.
+	class Ranges
+	{
+	public:
+		Ranges(const Range* first, size_t count) : m_first{ first }, m_count{ count } {}
+
+		const Range* begin() const { return m_first; }
+		const Range* end() const { return m_first + m_count; }
+		const Range& operator[](size_t i) const { return m_first[i]; }
+		size_t size() const { return m_count; }
+		bool empty() const { return m_count == 0; }
+
+	private:
+		const Range* m_first{};
+		size_t m_count{};
+	};
+
+	// Compiles cards into a catalog, the cards keep their order.
+	static std::shared_ptr<const Catalog> compile(const std::vector<Card>& cards);
+
+	// Number of cards.
+	size_t size() const { return m_lengths.size(); }
+	bool empty() const { return m_lengths.empty(); }
+
+	// The issuer of card i.
+	std::string_view issuer(size_t i) const { return issuer_name(m_issuer_ids[i]); }
+
+	// The interned issuer of card i, cards of the same issuer have the same id.
+	uint32_t issuer_id(size_t i) const { return m_issuer_ids[i]; }
+
+	// Number of distinct issuers, the ids are 0 to issuer_count() - 1 in order of first appearance.
+	size_t issuer_count() const { return m_name_offsets.size() - 1; }
+
+	// The name of an interned issuer.
+	std::string_view issuer_name(uint32_t id) const { return std::string_view(m_names).substr(m_name_offsets[id], m_name_offsets[id + 1] - m_name_offsets[id]); }
+
+	// The length of the numbers of card i.
+	int length(size_t i) const { return m_lengths[i]; }
+
+	// The prefixes of card i as the user wrote them, e.g. "51-55,2221-2720".
+	std::string_view prefixes(size_t i) const { return std::string_view(m_prefixes).substr(m_prefix_offsets[i], m_prefix_offsets[i + 1] - m_prefix_offsets[i]); }
+
+	// The parsed ranges of card i.
+	Ranges ranges(size_t i) const { return Ranges(m_ranges.data() + m_range_offsets[i], m_range_offsets[i + 1] - m_range_offsets[i]); }
+
+	// Number of ranges of all the cards.
+	size_t range_count() const { return m_ranges.size(); }
+
+	// Generates a number of card i from rng and appends it to out, the number Card::generate_card draws.
+	void generate_card(size_t i, std::string& out, std::mt19937& rng) const { Card::generate_number(ranges(i).begin(), ranges(i).size(), m_lengths[i], out, rng); }
+
+	// Card i as an editable Card.
+	Card card(size_t i) const;
+
+	// Bytes used by the arrays of the catalog.
+	size_t memory_bytes() const;
+
+private:
+	Catalog() = default;
+
+	std::string m_names{};						// Interned issuer names, one after the other.
+	std::vector<uint32_t> m_name_offsets{ 0 };	// Start of every name in m_names, and the end of the last one.
+	std::vector<uint32_t> m_issuer_ids{};		// Interned issuer of every card.
+	std::vector<int> m_lengths{};				// Length of every card.
+	std::string m_prefixes{};					// Prefixes text of every card, one after the other.
+	std::vector<uint32_t> m_prefix_offsets{ 0 };	// Start of every prefixes text, and the end of the last one.
+	std::vector<Range> m_ranges{};				// Ranges of every card, one card after the other.
+	std::vector<uint32_t> m_range_offsets{ 0 };	// First range of every card, and the end of the last card.
+};
+
+/**
+ * @class CatalogStore
+ * @brief The current version of an edited catalog, published read-copy-update style.
+ *
+ * The editor works on its own list of cards and publishes a compiled snapshot of it; readers
+ * take the current snapshot when they start and keep it until they end. Publishing never waits
+ * for the readers and never changes a snapshot they hold, an old version is freed when the last
+ * job that uses it drops its reference. A job started after a publish gets the new version.
+ *
+ * current() and publish() may be called from any thread, the snapshot pointer is swapped
+ * atomically.
+ */
+class CatalogStore
+{
+public:
+	CatalogStore() : m_current{ Catalog::compile({}) } {}
+
+	// The current snapshot, never nullptr.
+	std::shared_ptr<const Catalog> current() const { return std::atomic_load(&m_current); }
+
+	// Compiles cards and publishes them as the current snapshot, returns the snapshot.
+	std::shared_ptr<const Catalog> publish(const std::vector<Card>& cards);
+
+	// Publishes an already compiled snapshot.
+	void publish(std::shared_ptr<const Catalog> catalog);
+
+	// Number of snapshots published so far.
+	unsigned long long version() const { return m_version; }
+
+private:
+	std::shared_ptr<const Catalog> m_current{};
+	std::atomic<unsigned long long> m_version{};
+};
@@ -0,0 +1,123 @@
+#include "CatalogDb.h"
+
+/**
+ * @brief Opens a catalog session.
+ *
+ * The file must be an SQLite database (or not exist yet, in read-write mode). Read-write
+ * sessions switch it to WAL journaling with synchronous=NORMAL, every session sets the
+ * memory map, page cache and temporary storage pragmas. Failing to apply one of the tuning
+ * pragmas isn't an error, the session just runs with the SQLite default.
+ *
+ * @param path The path of the database file.
+ * @param mode Whether the session may write, read-only sessions are opened in serialized mode.
+ * @param err_msg A string reference to store error messages, if any.
+ * @return A shared pointer to the session if successful; nullptr otherwise.
+ */
+std::shared_ptr<CatalogDb> CatalogDb::open(const std::string& path, Mode mode, std::string& err_msg)
+{
+	int flags{ mode == Mode::read_only ? SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX };
+	sqlite3* db{ nullptr };
+	if (sqlite3_open_v2(path.c_str(), &db, flags, nullptr) != SQLITE_OK)
+	{
+		err_msg = "Failed to open the database: " + std::string(db != nullptr ? sqlite3_errmsg(db) : "out of memory");
+		sqlite3_close(db);
+		return nullptr;
+	}
+	std::shared_ptr<CatalogDb> session{ new CatalogDb(db, mode) };
+
+	// reading the schema fails if the file isn't a database
+	if (session->exec("SELECT name FROM sqlite_master WHERE type='table' LIMIT 1") != SQLITE_OK)
+	{
+		err_msg = "Not a valid database: " + session->errmsg();
+		return nullptr;
+	}
+
+	sqlite3_busy_timeout(db, busy_timeout);
+	if (mode == Mode::read_write)
+	{
+		session->exec("PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;");
+	}
+	std::string pragmas{ "PRAGMA mmap_size = " + std::to_string(mmap_size) + "; PRAGMA cache_size = " + std::to_string(cache_size) + "; PRAGMA temp_store = MEMORY;" };
+	session->exec(pragmas.c_str());
+
+	return session;
+}
+
+/**
+ * @brief Leases a prepared statement.
+ *
+ * A statement of the same SQL that isn't leased is taken from the cache, otherwise a new one
+ * is prepared. The lease returns it to the cache, reset and with its bindings cleared.
+ *
+ * @param sql A single SQL statement.
+ * @param rc Receives SQLITE_OK or the error of sqlite3_prepare_v2.
+ * @return The leased statement, empty if it couldn't be prepared.
+ */
+CatalogDb::Statement CatalogDb::prepare(const std::string& sql, int& rc)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		auto it = m_statements.find(sql);
+		if (it != m_statements.end())
+		{
+			sqlite3_stmt* stmt{ it->second };
+			m_statements.erase(it);
+			rc = SQLITE_OK;
+			return Statement{ *this, sql, stmt };
+		}
+	}
+
+	sqlite3_stmt* stmt{ nullptr };
+	rc = sqlite3_prepare_v3(m_db, sql.c_str(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+	if (rc != SQLITE_OK)
+	{
+		sqlite3_finalize(stmt);
+		stmt = nullptr;
+	}
+	return Statement{ *this, sql, stmt };
+}
+
+/**
+ * @brief Runs SQL that returns no rows.
+ *
+ * @param sql One or more SQL statements.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int CatalogDb::exec(const char* sql)
+{
+	return sqlite3_exec(m_db, sql, nullptr, nullptr, nullptr);
+}
+
+/**
+ * @brief Returns a leased statement to the cache.
+ */
+void CatalogDb::release(const std::string& sql, sqlite3_stmt* stmt)
+{
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_statements.emplace(sql, stmt);
+}
+
+/**
+ * @brief Finalizes the cached statements and closes the connection.
+ */
+CatalogDb::~CatalogDb()
+{
+	for (auto& statement : m_statements)
+	{
+		sqlite3_finalize(statement.second);
+	}
+	sqlite3_close(m_db);
+}
+
+/**
+ * @brief Returns the statement to the session's cache.
+ */
+CatalogDb::Statement::~Statement()
+{
+	if (m_stmt != nullptr)
+	{
+		m_owner->release(m_sql, m_stmt);
+	}
+}
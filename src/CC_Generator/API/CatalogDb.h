@@ -0,0 +1,87 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#ifdef CCGEN_EXTENSION
+// the loadable extension calls SQLite through the API table of the host connection
+#include "Dependencies/sqlite/sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+#else
+#include "Dependencies/sqlite/sqlite3.h"
+#endif
+
+/**
+ * @class CatalogDb
+ * @brief A session on a catalog database: one tuned SQLite connection and its prepared statements.
+ *
+ * Read-write sessions switch the database to WAL with synchronous=NORMAL, so a save is a
+ * sequential append to the log with a single sync at checkpoint time rather than a rollback
+ * journal synced on every commit. Every session maps the file (mmap_size), keeps a larger page
+ * cache and temporary tables in memory.
+ *
+ * Statements are prepared once per SQL text and reused: a lease takes a statement out of the
+ * cache and returns it reset when it goes out of scope. Read-only sessions are opened in
+ * serialized mode and can be shared by several threads, each concurrent lease gets its own
+ * statement. A read-write session must be used by one thread at a time.
+ */
+class CatalogDb : public std::enable_shared_from_this<CatalogDb>
+{
+public:
+	enum class Mode
+	{
+		read_write,	// Creates the file if it doesn't exist.
+		read_only	// Can be shared across threads.
+	};
+
+	// A prepared statement leased from the session's cache.
+	class Statement
+	{
+	public:
+		Statement(CatalogDb& owner, const std::string& sql, sqlite3_stmt* stmt) : m_owner{ &owner }, m_sql{ sql }, m_stmt{ stmt } {}
+		Statement(Statement&& other) noexcept : m_owner{ other.m_owner }, m_sql{ std::move(other.m_sql) }, m_stmt{ other.m_stmt } { other.m_stmt = nullptr; }
+		Statement(const Statement&) = delete;
+		Statement& operator=(const Statement&) = delete;
+		Statement& operator=(Statement&&) = delete;
+		~Statement();
+
+		sqlite3_stmt* get() const { return m_stmt; }
+		explicit operator bool() const { return m_stmt != nullptr; }
+
+	private:
+		CatalogDb* m_owner;
+		std::string m_sql;
+		sqlite3_stmt* m_stmt;
+	};
+
+	// Opens the database at path and applies the session pragmas, returns nullptr and sets err_msg on failure.
+	static std::shared_ptr<CatalogDb> open(const std::string& path, Mode mode, std::string& err_msg);
+
+	// Leases the cached statement of sql, preparing it on first use. rc receives the SQLite result code.
+	Statement prepare(const std::string& sql, int& rc);
+
+	// Runs one or more statements that return no rows (transactions, DDL).
+	int exec(const char* sql);
+
+	sqlite3* handle() const { return m_db; }
+	bool read_only() const { return m_mode == Mode::read_only; }
+	std::string errmsg() const { return sqlite3_errmsg(m_db); }
+
+	CatalogDb(const CatalogDb&) = delete;
+	CatalogDb& operator=(const CatalogDb&) = delete;
+	~CatalogDb();
+
+private:
+	CatalogDb(sqlite3* db, Mode mode) : m_db{ db }, m_mode{ mode } {}
+
+	void release(const std::string& sql, sqlite3_stmt* stmt);
+
+	static constexpr long long mmap_size{ 256LL << 20 };	// Bytes of the file to map.
+	static constexpr int cache_size{ -16384 };				// Page cache in KiB (negative), 16 MiB.
+	static constexpr int busy_timeout{ 5000 };				// Milliseconds to wait for another writer.
+
+	sqlite3* m_db;
+	Mode m_mode;
+	std::mutex m_mutex{};
+	std::unordered_multimap<std::string, sqlite3_stmt*> m_statements{};
+};
@@ -0,0 +1,546 @@
+#include "Ccgen.h"
+#include "DB_API.h"
+#include "BinIndex.h"
+#include <chrono>
+
+// The columns of the table, seed and catalog are hidden.
+enum CcgenColumn
+{
+	column_pan,
+	column_issuer,
+	column_length,
+	column_seed,
+	column_catalog,
+	column_count
+};
+
+/**
+ * @struct CcgenTable
+ * @brief A ccgen table and the catalog it last read.
+ */
+struct CcgenTable : sqlite3_vtab
+{
+	std::string default_path{};							// The catalog when the query doesn't constrain it.
+	std::string path{};									// The catalog of db.
+	std::shared_ptr<CatalogDb> db{};
+	long long data_version{ -1 };						// PRAGMA data_version when catalog was read.
+	std::shared_ptr<const Catalog> catalog{};
+};
+
+/**
+ * @struct CcgenCursor
+ * @brief A scan of a ccgen table, the current row is generated when the cursor steps to it.
+ */
+struct CcgenCursor : sqlite3_vtab_cursor
+{
+	std::shared_ptr<const Catalog> catalog{};			// Kept alive if the table reads the catalog again.
+	std::vector<int> indexes{};							// The cards that match the constraints.
+	std::string path{};
+	unsigned long long seed{};
+	unsigned long long row{};
+	std::mt19937 rng{};
+	std::string pan{};
+	int card{ -1 };
+};
+
+/**
+ * @brief Replaces the error message of a table.
+ */
+static void set_error(sqlite3_vtab* vtab, const std::string& err_msg)
+{
+	sqlite3_free(vtab->zErrMsg);
+	vtab->zErrMsg = sqlite3_mprintf("%s", err_msg.c_str());
+}
+
+/**
+ * @brief Returns PRAGMA data_version of a session, it changes when another connection commits.
+ */
+static long long read_data_version(CatalogDb& db)
+{
+	int rc{};
+	CatalogDb::Statement stmt{ db.prepare("PRAGMA data_version", rc) };
+	if (rc == SQLITE_OK && sqlite3_step(stmt.get()) == SQLITE_ROW)
+	{
+		return sqlite3_column_int64(stmt.get(), 0);
+	}
+	return -1;
+}
+
+/**
+ * @brief Reads the catalog at path unless the table already holds its current version.
+ *
+ * The session of the catalog is kept open, "PRAGMA data_version" changes when another
+ * connection commits to the file and the catalog is read again.
+ *
+ * @param table The table.
+ * @param path The path of the catalog.
+ * @return SQLITE_OK if table->catalog holds the catalog, an SQLite error code otherwise.
+ */
+static int load_catalog(CcgenTable* table, const std::string& path)
+{
+	std::string err_msg{};
+	if (table->db == nullptr || table->path != path)
+	{
+		table->catalog.reset();
+		table->data_version = -1;
+		table->db = DB_API::check_file_exists(path) ? DB_API::read_db(path, CatalogDb::Mode::read_only) : nullptr;
+		table->path = path;
+		if (table->db == nullptr)
+		{
+			set_error(table, "Failed to read the catalog \"" + path + "\"");
+			return SQLITE_ERROR;
+		}
+	}
+
+	long long data_version{ read_data_version(*table->db) };
+
+	if (table->catalog == nullptr || data_version != table->data_version)
+	{
+		if (DB_API::read_catalog(table->db, table->catalog, err_msg) != SQLITE_OK)
+		{
+			set_error(table, "Failed to read the catalog \"" + path + "\". " + err_msg);
+			return SQLITE_ERROR;
+		}
+		table->data_version = data_version;
+	}
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Generates the card of the cursor's current row.
+ *
+ * Rows are drawn like File::export_cards() draws cards, from a generator derived from the
+ * seed for every batch of File::batch_cards rows, so the rows of a seed match the export.
+ */
+static void generate_row(CcgenCursor* cursor)
+{
+	if (cursor->row % File::batch_cards == 0)
+	{
+		cursor->rng = File::batch_rng(cursor->seed, cursor->row / File::batch_cards);
+	}
+	cursor->pan.clear();
+	cursor->card = File::choose_random_index(cursor->indexes, cursor->rng);
+	cursor->catalog->generate_card(cursor->card, cursor->pan, cursor->rng);
+}
+
+/**
+ * @brief Creates or connects to a ccgen table (xCreate and xConnect).
+ *
+ * "CREATE VIRTUAL TABLE t USING ccgen('other.db')" makes other.db the default catalog of t,
+ * the eponymous table uses Ccgen::default_catalog. A failure is described in err_msg.
+ */
+static int ccgen_connect(sqlite3* db, void*, int argc, const char* const* argv, sqlite3_vtab** vtab, char** err_msg)
+{
+	int rc{ sqlite3_declare_vtab(db, "CREATE TABLE x(pan TEXT, issuer TEXT, length INTEGER, seed HIDDEN, catalog HIDDEN)") };
+	if (rc != SQLITE_OK)
+	{
+		*err_msg = sqlite3_mprintf("ccgen: %s", sqlite3_errmsg(db));
+		return rc;
+	}
+
+	CcgenTable* table{ new CcgenTable{} };
+	table->default_path = Ccgen::default_catalog;
+	if (argc > 3)
+	{
+		std::string path{ argv[3] };
+		if (path.size() >= 2 && (path.front() == '\'' || path.front() == '"') && path.back() == path.front())
+		{
+			path = path.substr(1, path.size() - 2);
+		}
+		table->default_path = path;
+	}
+	*vtab = table;
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Destroys the table object (xDisconnect and xDestroy).
+ */
+static int ccgen_disconnect(sqlite3_vtab* vtab)
+{
+	delete static_cast<CcgenTable*>(vtab);
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Plans a scan (xBestIndex).
+ *
+ * The first usable equality constraint of each of issuer, length, seed and catalog is passed
+ * to xFilter in that order and not checked again by SQLite, idxNum holds a bit per column.
+ * The table has no end, the cost only prefers plans that constrain more columns.
+ */
+static int ccgen_best_index(sqlite3_vtab*, sqlite3_index_info* info)
+{
+	int constraints[column_count]{ -1, -1, -1, -1, -1 };
+	for (int i{}; i < info->nConstraint; i++)
+	{
+		const auto& constraint{ info->aConstraint[i] };
+		if (constraint.usable && constraint.op == SQLITE_INDEX_CONSTRAINT_EQ && constraint.iColumn > column_pan && constraints[constraint.iColumn] < 0)
+		{
+			constraints[constraint.iColumn] = i;
+		}
+	}
+
+	int argv_index{};
+	info->idxNum = 0;
+	for (int column{ column_issuer }; column < column_count; column++)
+	{
+		if (constraints[column] >= 0)
+		{
+			info->aConstraintUsage[constraints[column]].argvIndex = ++argv_index;
+			info->aConstraintUsage[constraints[column]].omit = 1;
+			info->idxNum |= 1 << column;
+		}
+	}
+	info->estimatedCost = 1e12 / (1 + argv_index);
+	info->estimatedRows = std::numeric_limits<int>::max();
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Opens a cursor (xOpen).
+ */
+static int ccgen_open(sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+{
+	*cursor = new CcgenCursor{};
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Closes a cursor (xClose).
+ */
+static int ccgen_close(sqlite3_vtab_cursor* cursor)
+{
+	delete static_cast<CcgenCursor*>(cursor);
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Starts a scan (xFilter): reads the catalog, selects the matching cards and generates the first row.
+ *
+ * A NULL issuer, length or catalog matches no card, like "= NULL" in SQL.
+ */
+static int ccgen_filter(sqlite3_vtab_cursor* base, int idx_num, const char*, int argc, sqlite3_value** argv)
+{
+	CcgenCursor* cursor{ static_cast<CcgenCursor*>(base) };
+	CcgenTable* table{ static_cast<CcgenTable*>(base->pVtab) };
+	bool empty{ false };
+	int arg{};
+
+	auto next_value = [&](int column) -> sqlite3_value*
+	{
+		if ((idx_num & (1 << column)) == 0 || arg >= argc)
+		{
+			return nullptr;
+		}
+		sqlite3_value* value{ argv[arg++] };
+		empty = empty || sqlite3_value_type(value) == SQLITE_NULL;
+		return value;
+	};
+	sqlite3_value* issuer{ next_value(column_issuer) };
+	sqlite3_value* length{ next_value(column_length) };
+	sqlite3_value* seed{ next_value(column_seed) };
+	sqlite3_value* catalog{ next_value(column_catalog) };
+
+	cursor->seed = seed != nullptr ? static_cast<unsigned long long>(sqlite3_value_int64(seed)) : File::random_seed();
+	cursor->path = catalog != nullptr && empty == false ? reinterpret_cast<const char*>(sqlite3_value_text(catalog)) : table->default_path;
+	cursor->indexes.clear();
+	cursor->row = 0;
+	if (empty)
+	{
+		return SQLITE_OK;
+	}
+
+	int rc{ load_catalog(table, cursor->path) };
+	if (rc != SQLITE_OK)
+	{
+		return rc;
+	}
+	cursor->catalog = table->catalog;
+
+	std::string issuer_str{ issuer != nullptr ? reinterpret_cast<const char*>(sqlite3_value_text(issuer)) : "" };
+	int length_value{ length != nullptr ? sqlite3_value_int(length) : 0 };
+	for (int i{}; i < static_cast<int>(cursor->catalog->size()); i++)
+	{
+		if ((issuer == nullptr || cursor->catalog->issuer(i) == issuer_str) && (length == nullptr || cursor->catalog->length(i) == length_value))
+		{
+			cursor->indexes.push_back(i);
+		}
+	}
+
+	if (cursor->indexes.empty() == false)
+	{
+		generate_row(cursor);
+	}
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Steps to the next row (xNext).
+ */
+static int ccgen_next(sqlite3_vtab_cursor* base)
+{
+	CcgenCursor* cursor{ static_cast<CcgenCursor*>(base) };
+	cursor->row++;
+	generate_row(cursor);
+	return SQLITE_OK;
+}
+
+/**
+ * @brief The scan only ends when no card matches, otherwise it's ended by LIMIT (xEof).
+ */
+static int ccgen_eof(sqlite3_vtab_cursor* base)
+{
+	return static_cast<CcgenCursor*>(base)->indexes.empty();
+}
+
+/**
+ * @brief Returns a column of the current row (xColumn).
+ */
+static int ccgen_column(sqlite3_vtab_cursor* base, sqlite3_context* ctx, int column)
+{
+	CcgenCursor* cursor{ static_cast<CcgenCursor*>(base) };
+	const Catalog& catalog{ *cursor->catalog };
+	switch (column)
+	{
+	case column_pan:
+		sqlite3_result_text(ctx, cursor->pan.data(), static_cast<int>(cursor->pan.size()), SQLITE_TRANSIENT);
+		break;
+	case column_issuer:
+		sqlite3_result_text(ctx, catalog.issuer(cursor->card).data(), static_cast<int>(catalog.issuer(cursor->card).size()), SQLITE_TRANSIENT);
+		break;
+	case column_length:
+		sqlite3_result_int(ctx, catalog.length(cursor->card));
+		break;
+	case column_seed:
+		sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(cursor->seed));
+		break;
+	case column_catalog:
+		sqlite3_result_text(ctx, cursor->path.c_str(), -1, SQLITE_TRANSIENT);
+		break;
+	default:
+		break;
+	}
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Returns the rowid of the current row, the first row is 1 (xRowid).
+ */
+static int ccgen_rowid(sqlite3_vtab_cursor* base, sqlite3_int64* rowid)
+{
+	*rowid = static_cast<sqlite3_int64>(static_cast<CcgenCursor*>(base)->row + 1);
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Registers the ccgen module.
+ *
+ * xCreate and xConnect are the same function, which makes "ccgen" usable as an eponymous
+ * table without "CREATE VIRTUAL TABLE".
+ *
+ * @param db The connection to register the module on.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int Ccgen::register_module(sqlite3* db)
+{
+	static const sqlite3_module module{ []()
+	{
+		sqlite3_module m{};
+		m.iVersion = 0;
+		m.xCreate = ccgen_connect;
+		m.xConnect = ccgen_connect;
+		m.xBestIndex = ccgen_best_index;
+		m.xDisconnect = ccgen_disconnect;
+		m.xDestroy = ccgen_disconnect;
+		m.xOpen = ccgen_open;
+		m.xClose = ccgen_close;
+		m.xFilter = ccgen_filter;
+		m.xNext = ccgen_next;
+		m.xEof = ccgen_eof;
+		m.xColumn = ccgen_column;
+		m.xRowid = ccgen_rowid;
+		return m;
+	}() };
+
+	return sqlite3_create_module_v2(db, module_name, &module, nullptr, nullptr);
+}
+
+/**
+ * @struct IssuerLookup
+ * @brief The state of ccgen_issuer on a connection, the catalog it reads and its compiled index.
+ */
+struct IssuerLookup
+{
+	std::mutex mutex{};
+	CatalogDb* session{};					// The connection's own catalog, nullptr in the extension.
+	std::string path{};						// The catalog of index, empty for session.
+	std::shared_ptr<CatalogDb> db{};		// The session on path.
+	long long data_version{ -1 };			// PRAGMA data_version when index was built.
+	int changes{ -1 };						// Changes made by session itself when index was built.
+	std::chrono::steady_clock::time_point checked{};
+	BinIndex index{};
+};
+
+/**
+ * @brief Makes sure the index of a lookup holds the current version of a catalog.
+ *
+ * The version of the catalog is only checked every Ccgen::check_interval_ms, a query over
+ * millions of numbers doesn't query the catalog for every one of them.
+ *
+ * @param lookup The state of ccgen_issuer.
+ * @param path The catalog, empty for the session's own or the default catalog.
+ * @param err_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+static int refresh_lookup(IssuerLookup& lookup, std::string path, std::string& err_msg)
+{
+	const bool own{ path.empty() && lookup.session != nullptr };
+	if (path.empty() && own == false)
+	{
+		path = Ccgen::default_catalog;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (path == lookup.path && lookup.data_version >= 0 && now - lookup.checked < std::chrono::milliseconds(Ccgen::check_interval_ms))
+	{
+		return SQLITE_OK;
+	}
+	if (path != lookup.path)
+	{
+		lookup.db = own || DB_API::check_file_exists(path) == false ? nullptr : DB_API::read_db(path, CatalogDb::Mode::read_only);
+		lookup.path = path;
+		lookup.data_version = -1;
+		if (own == false && lookup.db == nullptr)
+		{
+			err_msg = "Failed to read the catalog \"" + path + "\"";
+			return SQLITE_ERROR;
+		}
+	}
+
+	std::shared_ptr<CatalogDb> db{ own ? lookup.session->shared_from_this() : lookup.db };
+	long long data_version{ read_data_version(*db) };
+	int changes{ own ? sqlite3_total_changes(db->handle()) : 0 };
+	lookup.checked = now;
+	if (data_version == lookup.data_version && changes == lookup.changes)
+	{
+		return SQLITE_OK;
+	}
+
+	std::shared_ptr<const Catalog> catalog{};
+	int rc{ DB_API::read_catalog(db, catalog, err_msg) };
+	if (rc != SQLITE_OK)
+	{
+		lookup.data_version = -1;
+		err_msg = "Failed to read the catalog. " + err_msg;
+		return rc;
+	}
+	lookup.index.build(*catalog);
+	lookup.data_version = data_version;
+	lookup.changes = changes;
+	return SQLITE_OK;
+}
+
+/**
+ * @brief luhn_valid(number): 1 if number is a string of digits with a correct Luhn check digit, 0 if not, NULL for NULL.
+ */
+static void luhn_valid_function(sqlite3_context* ctx, int, sqlite3_value** argv)
+{
+	if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+	{
+		sqlite3_result_null(ctx);
+		return;
+	}
+	const char* number{ reinterpret_cast<const char*>(sqlite3_value_text(argv[0])) };
+	sqlite3_result_int(ctx, Card::luhn_valid(std::string_view(number, sqlite3_value_bytes(argv[0]))) ? 1 : 0);
+}
+
+/**
+ * @brief luhn_complete(digits): digits followed by their Luhn check digit, NULL if digits is NULL, empty or not all digits.
+ */
+static void luhn_complete_function(sqlite3_context* ctx, int, sqlite3_value** argv)
+{
+	if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+	{
+		sqlite3_result_null(ctx);
+		return;
+	}
+	std::string_view digits{ reinterpret_cast<const char*>(sqlite3_value_text(argv[0])), static_cast<size_t>(sqlite3_value_bytes(argv[0])) };
+	if (digits.empty() || digits.find_first_not_of("0123456789") != std::string_view::npos)
+	{
+		sqlite3_result_null(ctx);
+		return;
+	}
+	std::string number{ digits };
+	number += static_cast<char>('0' + Card::luhn_digit(digits));
+	sqlite3_result_text(ctx, number.data(), static_cast<int>(number.size()), SQLITE_TRANSIENT);
+}
+
+/**
+ * @brief ccgen_issuer(number [, catalog]): the issuer of number in the catalog, NULL if no range matches.
+ *
+ * Without a catalog path the connection's own catalog is used (connections of
+ * DB_API::read_db) or Ccgen::default_catalog (the loadable extension).
+ */
+static void ccgen_issuer_function(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+{
+	if (argc < 1 || argc > 2)
+	{
+		sqlite3_result_error(ctx, "ccgen_issuer takes a card number and an optional catalog path", -1);
+		return;
+	}
+	if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+	{
+		sqlite3_result_null(ctx);
+		return;
+	}
+
+	IssuerLookup* lookup{ static_cast<IssuerLookup*>(sqlite3_user_data(ctx)) };
+	std::lock_guard<std::mutex> lock{ lookup->mutex };
+	std::string err_msg{};
+	std::string path{ argc > 1 && sqlite3_value_type(argv[1]) != SQLITE_NULL ? reinterpret_cast<const char*>(sqlite3_value_text(argv[1])) : "" };
+	int rc{ refresh_lookup(*lookup, path, err_msg) };
+	if (rc != SQLITE_OK)
+	{
+		sqlite3_result_error(ctx, err_msg.c_str(), -1);
+		return;
+	}
+
+	const char* number{ reinterpret_cast<const char*>(sqlite3_value_text(argv[0])) };
+	const std::string* issuer{ lookup->index.find(std::string_view(number, sqlite3_value_bytes(argv[0]))) };
+	if (issuer == nullptr)
+	{
+		sqlite3_result_null(ctx);
+		return;
+	}
+	sqlite3_result_text(ctx, issuer->data(), static_cast<int>(issuer->size()), SQLITE_TRANSIENT);
+}
+
+/**
+ * @brief Registers luhn_valid, luhn_complete and ccgen_issuer.
+ *
+ * The Luhn functions are deterministic and innocuous, so they can be used in indexes,
+ * CHECK constraints and generated columns.
+ *
+ * @param db The connection to register the functions on.
+ * @param session The catalog session of db, nullptr if db isn't a catalog (the loadable extension).
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int Ccgen::register_functions(sqlite3* db, CatalogDb* session)
+{
+	static constexpr int pure{ SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS };
+	int rc{ sqlite3_create_function_v2(db, "luhn_valid", 1, pure, nullptr, luhn_valid_function, nullptr, nullptr, nullptr) };
+	if (rc == SQLITE_OK)
+	{
+		rc = sqlite3_create_function_v2(db, "luhn_complete", 1, pure, nullptr, luhn_complete_function, nullptr, nullptr, nullptr);
+	}
+	if (rc == SQLITE_OK)
+	{
+		IssuerLookup* lookup{ new IssuerLookup{} };
+		lookup->session = session;
+		// SQLite calls the destructor if the registration fails too
+		rc = sqlite3_create_function_v2(db, "ccgen_issuer", -1, SQLITE_UTF8, lookup, ccgen_issuer_function, nullptr, nullptr,
+			[](void* data) { delete static_cast<IssuerLookup*>(data); });
+	}
+	return rc;
+}
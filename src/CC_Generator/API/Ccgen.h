@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include "CatalogDb.h"
+
+/**
+ * @class Ccgen
+ * @brief The ccgen SQLite virtual table, an endless stream of generated cards, and the card functions.
+ *
+ * Every row is generated when SQLite steps to it, so a query such as
+ * "INSERT INTO t SELECT pan FROM ccgen WHERE issuer='Visa' LIMIT 10000000" fills a table
+ * without an intermediate file. The table has the columns pan, issuer and length and the
+ * hidden columns seed and catalog. Equality constraints on issuer, length, seed and catalog
+ * are handled by the table itself (xBestIndex), the other constraints are left to SQLite.
+ *
+ * The rows of a seed are the cards a batch export of the same catalog, seed and issuers
+ * writes, in the same order. Without a seed every query draws a random one. The catalog is
+ * read once per table and read again when the file changes.
+ *
+ * The functions luhn_valid(number), luhn_complete(digits) and ccgen_issuer(number [, catalog])
+ * check and complete card numbers inside queries. ccgen_issuer compiles the catalog into a
+ * BinIndex on first use and compiles it again when the catalog changes.
+ */
+class Ccgen
+{
+public:
+	// Registers the module on db, together with the eponymous table "ccgen" on default_catalog.
+	static int register_module(sqlite3* db);
+
+	// Registers the card functions on db, ccgen_issuer reads the catalog of session or default_catalog if it's nullptr.
+	static int register_functions(sqlite3* db, CatalogDb* session = nullptr);
+
+	static constexpr const char* module_name{ "ccgen" };
+	static constexpr const char* default_catalog{ "cards.db" };
+	static constexpr int check_interval_ms{ 1000 };	// How often ccgen_issuer checks whether the catalog changed.
+
+	Ccgen() = delete;
+};
@@ -1,4 +1,5 @@
 #include "DB_API.h"
+#include "Ccgen.h"
 
 /**
  * @brief Checks if the provided SQLite database is valid and accessible.
@@ -29,30 +30,29 @@ bool DB_API::is_sqlite_database(sqlite3*& db)
 }
 
 /**
- * @brief Reads an SQLite database from the specified path.
+ * @brief Opens a catalog session on the SQLite database at the specified path.
  *
  * This function attempts to open an SQLite database located at the given
  * file path. If the database opens successfully and is a valid SQLite database,
- * it returns a shared pointer to the opened database. If any error occurs during
+ * it returns a shared pointer to the session, with the card functions of Ccgen
+ * (luhn_valid, luhn_complete, ccgen_issuer) registered on it. If any error occurs during
  * the opening process, or if the file is not a valid SQLite database, it returns nullptr.
  *
  * @param db_path The path to the SQLite database file to be opened.
- * @return A shared pointer to the opened SQLite database if successful; nullptr otherwise.
+ * @param mode Read-write (the default) or read-only, read-only sessions can be shared across threads.
+ * @return A shared pointer to the opened session if successful; nullptr otherwise.
  *
- * @see DB_API::is_sqlite_database(sqlite3* db)
+ * @see CatalogDb::open
  */
-std::shared_ptr<sqlite3> DB_API::read_db(const std::string& db_path)
+std::shared_ptr<CatalogDb> DB_API::read_db(const std::string& db_path, CatalogDb::Mode mode)
 {
-	sqlite3* db;
-	if (sqlite3_open(db_path.c_str(), &db) != SQLITE_OK)
+	std::string err_msg{};
+	std::shared_ptr<CatalogDb> session{ CatalogDb::open(db_path, mode, err_msg) };
+	if (session != nullptr)
 	{
-		return nullptr;
+		Ccgen::register_functions(session->handle(), session.get());
 	}
-	if (DB_API::is_sqlite_database(db) == false)
-	{
-		return nullptr;
-	}
-	return std::shared_ptr<sqlite3> {db, [](sqlite3* ptr) {if (ptr) { sqlite3_close(ptr); }}};
+	return session;
 }
 
 /**
@@ -74,157 +74,469 @@ bool DB_API::check_file_exists(const std::string& filename)
 }
 
 /**
- * @brief Reads credit card data from the database.
+ * @brief Checks if a table exists in the main database.
  *
- * This function retrieves credit card data from the database and populates
- * a vector with Card objects containing valid card information.
+ * @param db The catalog session.
+ * @param name The name of the table.
+ * @return True if the table exists, false otherwise.
+ */
+static bool table_exists(CatalogDb& db, const char* name)
+{
+	int rc{};
+	CatalogDb::Statement stmt{ db.prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?1;", rc) };
+	return stmt && sqlite3_bind_text(stmt.get(), 1, name, -1, SQLITE_STATIC) == SQLITE_OK && sqlite3_step(stmt.get()) == SQLITE_ROW;
+}
+
+/**
+ * @brief Reads credit card data from the legacy cards_table.
+ *
+ * Older versions stored every card as one row of issuer, length and prefixes text.
  *
- * @param db A shared pointer to the SQLite database.
+ * @param db The catalog session.
  * @param data A vector to store Card objects with valid credit card information.
  * @param error_msg A string reference to store error messages, if any.
  * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
- *
  */
-int DB_API::read_cards(std::shared_ptr<sqlite3> db, std::vector<Card>& data, std::string& error_msg)
+static int read_legacy_cards(CatalogDb& db, std::vector<Card>& data, std::string& error_msg)
 {
-	char* err{};
 	std::vector<Card> temp_vec{};
-	const char* selectStatement{ "SELECT Issuer, Length, Prefixes FROM cards_table;" };
-	sqlite3_stmt* stmt{ nullptr };
-
-	int rc{ sqlite3_prepare_v2(db.get(), selectStatement, -1, &stmt, nullptr) };
-
+	std::vector<std::pair<int, int>> ranges{};
+	int rc{};
+	CatalogDb::Statement statement{ db.prepare("SELECT Issuer, Length, Prefixes FROM cards_table;", rc) };
 	if (rc != SQLITE_OK)
 	{
-		const char* table_statement = "select * from sqlite_master where type='table' and name='cards_table';";
-		if (sqlite3_prepare_v2(db.get(), table_statement, -1, &stmt, nullptr) == 0)
-		{
-			rc = SQLITE_OK;
-		}
-		sqlite3_finalize(stmt);
-		error_msg = "Prepare statement error: " + std::string(sqlite3_errmsg(db.get()));
+		error_msg = "Prepare statement error: " + db.errmsg();
 		return rc;
 	}
 
+	sqlite3_stmt* stmt{ statement.get() };
 	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
 	{
-		std::string issuer{ reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)) };
+		const unsigned char* issuer_text{ sqlite3_column_text(stmt, 0) };
+		const unsigned char* prefixes_text{ sqlite3_column_text(stmt, 2) };
+		std::string issuer{ issuer_text != nullptr ? reinterpret_cast<const char*>(issuer_text) : "" };
 		int length{ sqlite3_column_int(stmt, 1) };
-		std::string prefixes{ reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)) };
+		std::string prefixes{ prefixes_text != nullptr ? reinterpret_cast<const char*>(prefixes_text) : "" };
 
-		// skip invalid cards
-		if (Card::validate_card(issuer, length, prefixes))
+		// skip invalid cards, the prefixes are parsed once for validation and ranges
+		if (Card::validate_issuer(issuer) && Card::validate_length(length) && Card::parse_prefixes(prefixes, length, ranges))
 		{
-			temp_vec.push_back(Card{ issuer, length, prefixes });
+			temp_vec.push_back(Card{ issuer, length, std::move(ranges) });
 		}
 	}
 
 	if (rc != SQLITE_DONE)
 	{
-		error_msg = "Step statement error: " + std::string(sqlite3_errmsg(db.get()));
+		error_msg = "Step statement error: " + db.errmsg();
 		return rc;
 	}
 
-	sqlite3_finalize(stmt);
 	data = temp_vec;
 	return SQLITE_OK;
 }
 
 /**
- * @brief Writes credit card data to the database, updating existing entries.
+ * @brief Creates the issuers and ranges tables and their indexes if they don't exist.
+ *
+ * @param db The catalog session.
+ * @param error_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+static int create_schema(CatalogDb& db, std::string& error_msg)
+{
+	const char* schema{
+		"CREATE TABLE IF NOT EXISTS issuers (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE);"
+		"CREATE TABLE IF NOT EXISTS ranges (id INTEGER PRIMARY KEY, issuer_id INTEGER NOT NULL REFERENCES issuers (id), "
+		"length INTEGER NOT NULL, lo INTEGER NOT NULL, hi INTEGER NOT NULL, weight REAL NOT NULL DEFAULT 1, UNIQUE (issuer_id, length, lo, hi));"
+		"CREATE INDEX IF NOT EXISTS ranges_lo_hi ON ranges (lo, hi);" };
+	int rc{ db.exec(schema) };
+	if (rc != SQLITE_OK)
+	{
+		error_msg = "Failed to create the tables: " + db.errmsg();
+	}
+	return rc;
+}
+
+/**
+ * @brief Creates the catalog tables and makes them hold exactly the provided cards.
  *
- * This function creates a table for credit card data if it doesn't exist,
- * then updates existing entries and inserts new ones based on the provided data.
+ * Every range of every card is bound to a single prepared statement that fills a temporary
+ * table, the rest is set-based: new issuers and ranges are added with INSERT ... ON CONFLICT
+ * DO NOTHING against the unique constraints, ranges that are no longer in the catalog are
+ * deleted with an anti-join against the temporary table and so are issuers left without ranges.
+ * Unchanged ranges keep their row and weight.
  *
- * @param db A shared pointer to the SQLite database.
- * @param data A vector of Card objects containing credit card information.
+ * The caller must hold a write transaction.
+ *
+ * @param db The catalog session.
+ * @param catalog The cards to store.
  * @param error_msg A string reference to store error messages, if any.
+ * @param on_progress Called as the ranges are staged (the first half) and after every set-based step, may be empty.
  * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+static int write_ranges(CatalogDb& db, const Catalog& catalog, std::string& error_msg, const DB_API::WriteProgress& on_progress)
+{
+	size_t total{ catalog.range_count() };
+	size_t staged{};
+
+	int rc{ create_schema(db, error_msg) };
+	if (rc != SQLITE_OK)
+	{
+		return rc;
+	}
+	if ((rc = db.exec("CREATE TEMP TABLE IF NOT EXISTS new_ranges (issuer TEXT, length INTEGER, lo INTEGER, hi INTEGER); DELETE FROM temp.new_ranges;")) != SQLITE_OK)
+	{
+		error_msg = "Failed to create the tables: " + db.errmsg();
+		return rc;
+	}
+
+	// bind every range to the same statement
+	CatalogDb::Statement statement{ db.prepare("INSERT INTO temp.new_ranges (issuer, length, lo, hi) VALUES (?1, ?2, ?3, ?4);", rc) };
+	if (rc != SQLITE_OK)
+	{
+		error_msg = "Error preparing insert statement: " + db.errmsg();
+		return rc;
+	}
+	sqlite3_stmt* stmt{ statement.get() };
+	for (size_t i{}; i < catalog.size(); i++)
+	{
+		std::string_view issuer{ catalog.issuer(i) };
+		for (const auto& range : catalog.ranges(i))
+		{
+			sqlite3_bind_text(stmt, 1, issuer.data(), static_cast<int>(issuer.size()), SQLITE_STATIC);
+			sqlite3_bind_int(stmt, 2, catalog.length(i));
+			sqlite3_bind_int(stmt, 3, range.first);
+			sqlite3_bind_int(stmt, 4, range.second);
+
+			rc = sqlite3_step(stmt);
+			sqlite3_reset(stmt);
+			if (rc != SQLITE_DONE)
+			{
+				error_msg = "Failed to insert values: " + db.errmsg();
+				return rc;
+			}
+			if (on_progress && ++staged % DB_API::progress_rows == 0)
+			{
+				on_progress(0.5f * static_cast<float>(staged) / static_cast<float>(total));
+			}
+		}
+	}
+
+	// add the new issuers and ranges, then delete every range and issuer that isn't in data
+	const char* update_steps[]{
+		"INSERT INTO issuers (name) SELECT issuer FROM temp.new_ranges WHERE true GROUP BY issuer ORDER BY MIN(rowid) ON CONFLICT DO NOTHING;",
+		"INSERT INTO ranges (issuer_id, length, lo, hi) SELECT i.id, n.length, n.lo, n.hi FROM temp.new_ranges AS n "
+		"JOIN issuers AS i ON i.name = n.issuer WHERE true ORDER BY n.rowid ON CONFLICT DO NOTHING;",
+		"CREATE INDEX IF NOT EXISTS temp.new_ranges_index ON new_ranges (issuer, length, lo, hi);",
+		"DELETE FROM ranges WHERE NOT EXISTS (SELECT 1 FROM issuers AS i JOIN temp.new_ranges AS n ON n.issuer = i.name "
+		"WHERE i.id = ranges.issuer_id AND n.length = ranges.length AND n.lo = ranges.lo AND n.hi = ranges.hi);",
+		"DELETE FROM issuers WHERE NOT EXISTS (SELECT 1 FROM ranges WHERE ranges.issuer_id = issuers.id);",
+		"DELETE FROM temp.new_ranges;" };
+	const size_t steps{ sizeof(update_steps) / sizeof(update_steps[0]) };
+	for (size_t i{}; i < steps; i++)
+	{
+		if ((rc = db.exec(update_steps[i])) != SQLITE_OK)
+		{
+			error_msg = "Error updating the database: " + db.errmsg();
+			return rc;
+		}
+		if (on_progress)
+		{
+			on_progress(0.5f + 0.5f * static_cast<float>(i + 1) / static_cast<float>(steps));
+		}
+	}
+	return rc;
+}
+
+/**
+ * @brief Migrates a legacy cards_table into the issuers and ranges tables.
  *
- * @note The function assumes that the Card class has methods such as `get_issuer()`,
- *       `get_len()`, and `get_prefixes()` to retrieve the respective card details.
+ * The prefixes text of every valid legacy row is parsed once and stored as integer ranges,
+ * cards_table is then dropped. Nothing is done if the database has no cards_table.
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param error_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful or there was nothing to migrate, otherwise an error code
+ *         (SQLITE_READONLY if the database can't be written).
  */
-int DB_API::write_cards(std::shared_ptr<sqlite3> db, const std::vector<Card>& data, std::string& error_msg)
+int DB_API::migrate(std::shared_ptr<CatalogDb> db, std::string& error_msg)
 {
-	// create a table if it doesn't exist
-	char* err{};
-	int rc{ sqlite3_exec(db.get(), "CREATE TABLE IF NOT EXISTS cards_table (Issuer TEXT, Length INTEGER, Prefixes TEXT);", 0, 0, &err) };
+	if (table_exists(*db, "cards_table") == false)
+	{
+		return SQLITE_OK;
+	}
+	if (db->read_only())
+	{
+		return SQLITE_READONLY;
+	}
 
+	int rc{ db->exec("BEGIN IMMEDIATE;") };
 	if (rc != SQLITE_OK)
 	{
-		error_msg = "Failed with error: " + std::string(err);
+		error_msg = "Failed to begin a transaction: " + db->errmsg();
 		return rc;
 	}
 
-	std::string query{};
+	std::vector<Card> legacy_vec{};
+	if ((rc = read_legacy_cards(*db, legacy_vec, error_msg)) != SQLITE_OK ||
+		(rc = write_ranges(*db, *Catalog::compile(legacy_vec), error_msg, nullptr)) != SQLITE_OK)
+	{
+		db->exec("ROLLBACK");
+		return rc;
+	}
+	if ((rc = db->exec("DROP TABLE cards_table; COMMIT;")) != SQLITE_OK)
+	{
+		error_msg = "Failed to migrate the database: " + db->errmsg();
+		db->exec("ROLLBACK");
+	}
+	return rc;
+}
 
-	// loop through the vector - skip existing cards and write new cards
-	sqlite3_exec(db.get(), "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+/**
+ * @brief Prepares a database for writing ranges directly.
+ *
+ * Migrates a legacy cards_table and creates the issuers and ranges tables if they don't
+ * exist, for writers that add ranges without replacing the catalog (e.g. Importer).
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param error_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int DB_API::create_tables(std::shared_ptr<CatalogDb> db, std::string& error_msg)
+{
+	int rc{ DB_API::migrate(db, error_msg) };
+	return rc != SQLITE_OK ? rc : create_schema(*db, error_msg);
+}
 
-	bool first_iter{ true };
-	std::stringstream ss;
-	ss << "DELETE FROM cards_table";
-	if (data.empty() == false)
+/**
+ * @brief Reads credit card data from the database.
+ *
+ * This function retrieves credit card data from the database and populates
+ * a vector with Card objects containing valid card information.
+ *
+ * Every issuer and length is one card, its ranges are loaded as integers without
+ * parsing any text. A legacy cards_table is migrated first, or read as it is if
+ * the database is read-only.
+ *
+ * With on_progress, the cards are also passed to it in chunks as they are read, so a
+ * front end can show them before the whole catalog is loaded. data is only assigned once
+ * the read has completed.
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param data A vector to store Card objects with valid credit card information.
+ * @param error_msg A string reference to store error messages, if any.
+ * @param on_progress Receives the cards read since its previous call and the fraction read so far, may be empty.
+ *                    Called on the calling thread, returning false cancels the read with SQLITE_INTERRUPT.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ *
+ * @see DB_API::migrate
+ */
+int DB_API::read_cards(std::shared_ptr<CatalogDb> db, std::vector<Card>& data, std::string& error_msg, const ReadProgress& on_progress)
+{
+	int rc{ DB_API::migrate(db, error_msg) };
+	if ((rc & 0xff) == SQLITE_READONLY)
+	{
+		error_msg.clear();
+		if ((rc = read_legacy_cards(*db, data, error_msg)) == SQLITE_OK && on_progress)
+		{
+			on_progress(data, 1.0f);
+		}
+		return rc;
+	}
+	if (rc != SQLITE_OK)
 	{
-		ss << " WHERE ";
+		return rc;
 	}
 
-	for (const auto& card : data)
+	std::vector<Card> temp_vec{};
+	if (table_exists(*db, "ranges") == false)
 	{
-		// If the card doesn't exist in the database insert it
-		query = "INSERT INTO cards_table (Issuer, Length, Prefixes) "
-			"SELECT ?, ?, ? "
-			"WHERE NOT EXISTS (SELECT 1 FROM cards_table WHERE Issuer = ? AND Length = ? AND Prefixes = ?)";
+		data = temp_vec;
+		return SQLITE_OK;
+	}
 
-		sqlite3_stmt* stmt;
-		rc = sqlite3_prepare_v2(db.get(), query.c_str(), -1, &stmt, nullptr);
+	const char* select_statement{
+		"SELECT r.issuer_id, i.name, r.length, r.lo, r.hi FROM ranges AS r JOIN issuers AS i ON i.id = r.issuer_id "
+		"ORDER BY r.issuer_id, r.length, r.lo, r.hi;" };
+	CatalogDb::Statement statement{ db->prepare(select_statement, rc) };
+	if (rc != SQLITE_OK)
+	{
+		error_msg = "Prepare statement error: " + db->errmsg();
+		return rc;
+	}
+	sqlite3_stmt* stmt{ statement.get() };
 
-		if (rc != SQLITE_OK)
+	// the total is only needed for reporting progress
+	sqlite3_int64 total_rows{ 1 };
+	if (on_progress)
+	{
+		CatalogDb::Statement count{ db->prepare("SELECT COUNT(*) FROM ranges;", rc) };
+		if (rc == SQLITE_OK && sqlite3_step(count.get()) == SQLITE_ROW)
 		{
-			error_msg = "Error preparing select statement: " + std::string(sqlite3_errmsg(db.get()));
-			sqlite3_finalize(stmt);
-			return rc;
+			total_rows = std::max<sqlite3_int64>(1, sqlite3_column_int64(count.get(), 0));
 		}
-		std::string issuer_str = card.get_issuer();
-		std::string prefixes_str = card.get_prefixes();
+	}
 
-		const char* issuer = issuer_str.c_str();
-		const char* prefixes = prefixes_str.c_str();
+	sqlite3_int64 issuer_id{ -1 };
+	int length{ -1 };
+	std::string issuer{};
+	std::vector<std::pair<int, int>> ranges{};
+	bool valid{ true };
+	sqlite3_int64 rows{};
+	size_t reported{};
 
-		sqlite3_bind_text(stmt, 1, issuer, -1, SQLITE_STATIC);
-		sqlite3_bind_int(stmt, 2, card.get_len());
-		sqlite3_bind_text(stmt, 3, prefixes, -1, SQLITE_STATIC);
-		sqlite3_bind_text(stmt, 4, issuer, -1, SQLITE_STATIC);
-		sqlite3_bind_int(stmt, 5, card.get_len());
-		sqlite3_bind_text(stmt, 6, prefixes, -1, SQLITE_STATIC);
+	// passes the cards added since the previous report to on_progress
+	auto report = [&]() -> bool
+	{
+		std::vector<Card> chunk(temp_vec.begin() + reported, temp_vec.end());
+		reported = temp_vec.size();
+		return on_progress(chunk, static_cast<float>(rows) / static_cast<float>(total_rows));
+	};
 
-		if ((rc = sqlite3_step(stmt)) != SQLITE_DONE)
+	// adds the card whose ranges were just read, unless one of them was out of bounds
+	auto add_card = [&]()
+	{
+		if (valid && Card::validate_issuer(issuer) && Card::validate_length(length) && Card::validate_ranges(ranges, length))
 		{
-			error_msg = "Failed to insert values: " + std::string(sqlite3_errmsg(db.get()));
-			sqlite3_finalize(stmt);
-			return rc;
+			temp_vec.push_back(Card{ issuer, length, std::move(ranges) });
 		}
+		ranges.clear();
+		valid = true;
+	};
 
-		// delete query
-		if (!first_iter)
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+	{
+		sqlite3_int64 row_issuer_id{ sqlite3_column_int64(stmt, 0) };
+		int row_length{ sqlite3_column_int(stmt, 2) };
+		if (row_issuer_id != issuer_id || row_length != length)
 		{
-			ss << " AND ";
+			if (issuer_id != -1)
+			{
+				add_card();
+			}
+			issuer_id = row_issuer_id;
+			length = row_length;
+			issuer = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
 		}
 
-		ss << "NOT (Issuer='" << issuer_str << "' AND Length='" << card.get_len() << "' AND Prefixes='" << prefixes_str << "')";
-		first_iter = false;
+		sqlite3_int64 lo{ sqlite3_column_int64(stmt, 3) };
+		sqlite3_int64 hi{ sqlite3_column_int64(stmt, 4) };
+		valid = valid && lo <= std::numeric_limits<int>::max() && hi <= std::numeric_limits<int>::max();
+		ranges.emplace_back(static_cast<int>(lo), static_cast<int>(hi));
+
+		if (on_progress && ++rows % DB_API::progress_rows == 0 && report() == false)
+		{
+			error_msg = "Reading the database was cancelled.";
+			return SQLITE_INTERRUPT;
+		}
 	}
 
-	ss << ";";
+	if (rc != SQLITE_DONE)
+	{
+		error_msg = "Step statement error: " + db->errmsg();
+		return rc;
+	}
+	if (issuer_id != -1)
+	{
+		add_card();
+	}
+	if (on_progress)
+	{
+		rows = total_rows;
+		report();
+	}
 
-	std::string delete_query{ ss.str() };
+	data = std::move(temp_vec);
+	return SQLITE_OK;
+}
 
-	if ((rc = sqlite3_exec(db.get(), delete_query.c_str(), 0, 0, &err)) != SQLITE_OK)
+/**
+ * @brief Reads the catalog of the database into an immutable Catalog.
+ *
+ * For readers that only generate or look up cards (batch exports, the daemon, the ccgen
+ * table and functions), the cards are compiled as soon as they are read and the Card
+ * objects are dropped.
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param catalog Receives the compiled catalog, only assigned on success.
+ * @param error_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ *
+ * @see DB_API::read_cards
+ */
+int DB_API::read_catalog(std::shared_ptr<CatalogDb> db, std::shared_ptr<const Catalog>& catalog, std::string& error_msg)
+{
+	std::vector<Card> cards{};
+	int rc{ read_cards(db, cards, error_msg) };
+	if (rc == SQLITE_OK)
+	{
+		catalog = Catalog::compile(cards);
+	}
+	return rc;
+}
+
+/**
+ * @brief Writes credit card data to the database, updating existing entries.
+ *
+ * This function creates the catalog tables if they don't exist, then makes them hold
+ * exactly the provided cards: new ranges are inserted, existing ones are kept as they are
+ * and ranges that are no longer in the vector are deleted. Cards of the same issuer and
+ * length share their ranges. All of it runs in one transaction, which is rolled back on any error.
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param data A vector of Card objects containing credit card information.
+ * @param error_msg A string reference to store error messages, if any.
+ * @param on_progress Receives the fraction written so far, may be empty. Called on the calling thread.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ *
+ * @see DB_API::write_catalog
+ */
+int DB_API::write_cards(std::shared_ptr<CatalogDb> db, const std::vector<Card>& data, std::string& error_msg, const WriteProgress& on_progress)
+{
+	return write_catalog(db, *Catalog::compile(data), error_msg, on_progress);
+}
+
+/**
+ * @brief Writes a catalog snapshot to the database, see DB_API::write_cards.
+ *
+ * The snapshot can't change while it's written, so a save can run on a background thread
+ * while the cards keep being edited.
+ *
+ * @param db A shared pointer to the catalog session.
+ * @param catalog The snapshot to store.
+ * @param error_msg A string reference to store error messages, if any.
+ * @param on_progress Receives the fraction written so far, may be empty. Called on the calling thread.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int DB_API::write_catalog(std::shared_ptr<CatalogDb> db, const Catalog& catalog, std::string& error_msg, const WriteProgress& on_progress)
+{
+	if (db->read_only())
+	{
+		error_msg = "The database was opened read-only.";
+		return SQLITE_READONLY;
+	}
+
+	int rc{ DB_API::migrate(db, error_msg) };
+	if (rc != SQLITE_OK)
 	{
-		error_msg = "Error deleting data from database: " + std::string(sqlite3_errmsg(db.get()));
 		return rc;
 	}
 
-	sqlite3_exec(db.get(), "COMMIT", nullptr, nullptr, nullptr);
-	return SQLITE_OK;
+	if ((rc = db->exec("BEGIN IMMEDIATE;")) != SQLITE_OK)
+	{
+		error_msg = "Failed to begin a transaction: " + db->errmsg();
+		return rc;
+	}
+
+	if ((rc = write_ranges(*db, catalog, error_msg, on_progress)) != SQLITE_OK)
+	{
+		db->exec("ROLLBACK");
+		return rc;
+	}
+	if ((rc = db->exec("COMMIT")) != SQLITE_OK)
+	{
+		error_msg = "Failed to commit: " + db->errmsg();
+		db->exec("ROLLBACK");
+	}
+	return rc;
 }
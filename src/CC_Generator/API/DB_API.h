@@ -3,9 +3,13 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <limits>
+#include <functional>
 #include <sys/stat.h>
 #include "Dependencies/sqlite/sqlite3.h"
+#include "CatalogDb.h"
 #include "Card.h"
+#include "Catalog.h"
 #include "File.h"
 
 /**
@@ -19,20 +23,41 @@
 class DB_API
 {
 public:
+    // Receives the cards read since the previous call and the fraction of the catalog read so far, returning false cancels the read.
+    using ReadProgress = std::function<bool(const std::vector<Card>& cards, float progress)>;
+
+    // Receives the fraction of the catalog written so far.
+    using WriteProgress = std::function<void(float progress)>;
+
     // Checks if a file exists.
     static bool check_file_exists(const std::string& filename);
 
-    // Reads an SQLite database and returns a shared pointer to it.
-    static std::shared_ptr<sqlite3> read_db(const std::string& db_path);
+    // Opens a session on an SQLite database and returns a shared pointer to it.
+    static std::shared_ptr<CatalogDb> read_db(const std::string& db_path, CatalogDb::Mode mode = CatalogDb::Mode::read_write);
 
     // Checks if the provided object is an SQLite database.
     static bool is_sqlite_database(sqlite3*& db);
 
     // Writes credit card data to the database, updating existing entries.
-    static int write_cards(std::shared_ptr<sqlite3> db, const std::vector<Card>& data, std::string& error_msg);
+    static int write_cards(std::shared_ptr<CatalogDb> db, const std::vector<Card>& data, std::string& error_msg, const WriteProgress& on_progress = nullptr);
+
+    // Writes a catalog snapshot to the database, updating existing entries.
+    static int write_catalog(std::shared_ptr<CatalogDb> db, const Catalog& catalog, std::string& error_msg, const WriteProgress& on_progress = nullptr);
+
+    // Migrates a legacy cards_table into the issuers and ranges tables.
+    static int migrate(std::shared_ptr<CatalogDb> db, std::string& error_msg);
+
+    // Migrates the database and creates the issuers and ranges tables if they don't exist.
+    static int create_tables(std::shared_ptr<CatalogDb> db, std::string& error_msg);
 
     // Reads credit card data from the database and stores it in a vector.
-    static int read_cards(std::shared_ptr<sqlite3> db, std::vector<Card>& data, std::string& error_msg);
+    static int read_cards(std::shared_ptr<CatalogDb> db, std::vector<Card>& data, std::string& error_msg, const ReadProgress& on_progress = nullptr);
+
+    // Reads the catalog of the database and compiles it, see Catalog.
+    static int read_catalog(std::shared_ptr<CatalogDb> db, std::shared_ptr<const Catalog>& catalog, std::string& error_msg);
+
+    // Number of ranges between two progress reports.
+    static constexpr int progress_rows{ 4096 };
 
 	DB_API() = delete;
 };
\ No newline at end of file
@@ -11,7 +11,25 @@
 #include <string>
 #include <atomic>
 #include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <sys/stat.h>
 #include "Card.h"
+#include "Catalog.h"
+#include "Sink.h"
+#include "Pacer.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Probes.h"
+
+#if defined(_WIN64) || defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#endif
 
 extern std::atomic<bool> g_paused;
 extern std::atomic<bool> g_started;
@@ -27,6 +45,151 @@ class File
 {
 public:
 
+    /**
+     * @brief Output formats a generated card can be written in.
+     */
+    enum class Format
+    {
+        plain,  ///< One card number per line.
+        csv,    ///< "issuer,number" rows preceded by a header row.
+        json    ///< A JSON array of {"issuer": ..., "number": ...} objects.
+    };
+
+    /**
+     * @brief Parses the name of an output format.
+     *
+     * @param str The format name ("plain", "csv" or "json"), an empty string selects plain.
+     * @param format Receives the parsed format.
+     * @return True if the name is a known format, false otherwise.
+     */
+    static bool parse_format(const std::string& str, Format& format)
+    {
+        if (str.empty() || str == "plain" || str == "txt")
+        {
+            format = Format::plain;
+        }
+        else if (str == "csv")
+        {
+            format = Format::csv;
+        }
+        else if (str == "json")
+        {
+            format = Format::json;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends the text that opens a stream of records in the given format.
+     *
+     * @param out The string to append to.
+     * @param format The output format.
+     */
+    static void append_header(std::string& out, Format format)
+    {
+        switch (format)
+        {
+        case Format::csv:
+            out += "issuer,number\n";
+            break;
+        case Format::json:
+            out += "[";
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * @brief Appends str to out as a quoted and escaped JSON string.
+     *
+     * @param out The string to append to.
+     * @param str The raw string.
+     */
+    static void append_json_string(std::string& out, std::string_view str)
+    {
+        out += '"';
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char esc[8];
+                std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    /**
+     * @brief Generates one card and appends it to out as a record in the given format.
+     *
+     * @param out The string to append to.
+     * @param catalog The catalog.
+     * @param card The index of the card to generate a number from.
+     * @param format The output format.
+     * @param rng The random number generator to draw from.
+     * @param first True for the first record of the stream (controls the JSON separator).
+     */
+    static void append_record(std::string& out, const Catalog& catalog, size_t card, Format format, std::mt19937& rng, bool first)
+    {
+        switch (format)
+        {
+        case Format::csv:
+            out += '"';
+            for (char c : catalog.issuer(card))
+            {
+                out += c;
+                if (c == '"')
+                {
+                    out += '"';
+                }
+            }
+            out += "\",";
+            catalog.generate_card(card, out, rng);
+            out += '\n';
+            break;
+        case Format::json:
+            out += first ? "\n{\"issuer\":" : ",\n{\"issuer\":";
+            append_json_string(out, catalog.issuer(card));
+            out += ",\"number\":\"";
+            catalog.generate_card(card, out, rng);
+            out += "\"}";
+            break;
+        default:
+            catalog.generate_card(card, out, rng);
+            out += '\n';
+            break;
+        }
+    }
+
+    /**
+     * @brief Appends the text that closes a stream of records in the given format.
+     *
+     * @param out The string to append to.
+     * @param format The output format.
+     */
+    static void append_footer(std::string& out, Format format)
+    {
+        if (format == Format::json)
+        {
+            out += "\n]\n";
+        }
+    }
+
     /**
      * @brief Retrieves the indices of true values in a boolean vector.
      *
@@ -62,6 +225,18 @@ public:
      *
      */
     static int choose_random_index(const std::vector<int>& vec)
+    {
+        return choose_random_index(vec, gen);
+    }
+
+    /**
+     * @brief Chooses a random index from a vector of integers using the given generator.
+     *
+     * @param vec A vector of integers from which to choose a random index.
+     * @param rng The random number generator to draw from.
+     * @return A randomly selected index from the input vector, -1 if it's empty.
+     */
+    static int choose_random_index(const std::vector<int>& vec, std::mt19937& rng)
     {
         if (vec.empty())
         {
@@ -69,80 +244,768 @@ public:
         }
 
         std::uniform_int_distribution<int> dist(0, static_cast<int>(vec.size() - 1));
-        return vec[dist(gen)];
+        return vec[dist(rng)];
+    }
+
+    /**
+     * @brief Progress of an export, written periodically so an interrupted export can be resumed.
+     */
+    struct Checkpoint
+    {
+        unsigned long long seed{};              ///< Seed the export was started with.
+        unsigned long long amount{};            ///< Total number of cards requested.
+        unsigned long long cards_emitted{};     ///< Cards written to the file so far.
+        unsigned long long bytes_flushed{};     ///< Size of the file when the checkpoint was taken.
+        unsigned long long fingerprint{};       ///< catalog_fingerprint() of the selected cards.
+        unsigned long long max_bytes{};         ///< Byte target of the export, 0 if it has none.
+        unsigned long long time_budget_ms{};    ///< Time budget of the export in milliseconds, 0 if it has none.
+        unsigned long long elapsed_ms{};        ///< Unpaused generation time used so far, in milliseconds.
+    };
+
+    /**
+     * @brief Condition that ends an export.
+     */
+    enum class StopMode
+    {
+        cards,      ///< After a number of cards.
+        bytes,      ///< On the last record that fits in a number of bytes.
+        time        ///< After a number of seconds of unpaused generation.
+    };
+
+    /**
+     * @brief A stop condition as chosen in the front ends.
+     */
+    struct StopCondition
+    {
+        StopMode mode{ StopMode::cards };
+        unsigned long long value{ 1 };          ///< Cards, bytes or seconds, depending on mode.
+    };
+
+    /**
+     * @brief Outcome of export_cards.
+     */
+    struct ExportResult
+    {
+        unsigned long long cards{};             ///< Cards in the output when the export ended.
+        unsigned long long bytes{};             ///< Size of the output when the export ended.
+        bool complete{};                        ///< A stop condition was met, false if the export was stopped or failed.
+        bool report_written{};                  ///< The report was written, false if none was requested or it couldn't be written.
+    };
+
+    /**
+     * @brief Options of an export started with export_cards.
+     */
+    struct ExportOptions
+    {
+        unsigned long long seed{};                                      ///< Every batch of the export is derived from it.
+        std::string checkpoint_path{};                                  ///< Where to write checkpoints, empty disables them.
+        std::chrono::milliseconds checkpoint_interval{ 10000 };         ///< Minimum time between two checkpoints.
+        unsigned long long start_card{};                                ///< Cards already in the file when resuming.
+        unsigned long long start_bytes{};                               ///< Size of the file when resuming.
+        std::chrono::milliseconds start_elapsed{};                      ///< Unpaused time of the export before it was resumed, counted against time_budget.
+        Pacer* pacer{};                                                 ///< Limits the rate of the export, nullptr writes as fast as possible.
+        unsigned long long max_bytes{};                                 ///< Stop on the last record that fits, 0 for no byte target.
+        std::chrono::milliseconds time_budget{};                        ///< Stop after this much unpaused time, 0 for no time budget.
+        std::shared_ptr<Metrics> metrics{};                             ///< Receives the throughput of the export, nullptr for none.
+        std::string report_path{};                                      ///< Where to write the JSON report of the export, empty for none.
+        std::function<void(const ExportResult&)> finished{};            ///< Called on the export thread once the export ended, empty for none.
+    };
+
+    /**
+     * @brief What an export was asked to do and how it ended, written by write_report.
+     */
+    struct RunReport
+    {
+        unsigned long long seed{};
+        unsigned long long amount{};            ///< Cards requested, unlimited if only bytes or time end the export.
+        unsigned long long max_bytes{};         ///< Byte target, 0 if it has none.
+        std::chrono::milliseconds time_budget{};    ///< Time budget, 0 if it has none.
+        unsigned long long start_card{};        ///< Cards already in the output when the export resumed.
+        unsigned long long start_bytes{};       ///< Size of the output when the export resumed.
+        std::string sink{};                     ///< Sink::name() of the output.
+        long long started_at{};                 ///< Unix time the export started.
+        double wall_seconds{};                  ///< Time from the start to the end of the export, pauses included.
+        ExportResult result{};
+    };
+
+    static constexpr unsigned long long typical_record_bytes{ 17 };    ///< A 16 digit card and its newline, used for estimates.
+    static constexpr unsigned long long unlimited{ std::numeric_limits<unsigned long long>::max() };   ///< Amount of an export that ends on bytes or time.
+
+    /**
+     * @brief Applies a stop condition to the options of an export.
+     *
+     * @param stop The stop condition.
+     * @param options Receives the byte target or the time budget.
+     * @return The amount of cards to pass to export_cards.
+     */
+    static unsigned long long apply_stop(const StopCondition& stop, ExportOptions& options)
+    {
+        switch (stop.mode)
+        {
+        case StopMode::bytes:
+            options.max_bytes = stop.value;
+            return unlimited;
+        case StopMode::time:
+            options.time_budget = std::chrono::seconds(stop.value);
+            return unlimited;
+        default:
+            return stop.value;
+        }
+    }
+
+    /**
+     * @brief Returns where the report of an export to path goes when none was asked for.
+     *
+     * Only a regular file gets a report next to it, a device (/dev/null), a FIFO or a
+     * missing path has no place for one.
+     *
+     * @param path The output of the export, after it was opened.
+     * @return path with ".report.json" appended, empty if path isn't a regular file.
+     */
+    static std::string default_report_path(const std::string& path)
+    {
+        struct stat buffer {};
+        if (path.empty() || stat(path.c_str(), &buffer) != 0 || (buffer.st_mode & S_IFMT) != S_IFREG)
+        {
+            return "";
+        }
+        return path + ".report.json";
+    }
+
+    static constexpr unsigned long long batch_cards{ 4096 };    ///< Cards generated from a single seeded generator.
+
+    /**
+     * @brief Returns a random 64-bit seed for a new export.
+     */
+    static unsigned long long random_seed()
+    {
+        std::random_device rd{};
+        return (static_cast<unsigned long long>(rd()) << 32) | rd();
+    }
+
+    /**
+     * @brief Creates the generator of a batch.
+     *
+     * Every batch of batch_cards cards gets a generator derived from the export seed and
+     * the batch index, so any batch can be regenerated without generating the ones before it.
+     *
+     * @param seed The seed of the export.
+     * @param batch The index of the batch.
+     * @return The seeded generator.
+     */
+    static std::mt19937 batch_rng(unsigned long long seed, unsigned long long batch)
+    {
+        std::seed_seq seq{ static_cast<unsigned>(seed), static_cast<unsigned>(seed >> 32), static_cast<unsigned>(batch), static_cast<unsigned>(batch >> 32) };
+        return std::mt19937(seq);
+    }
+
+    /**
+     * @brief Computes a 64-bit FNV-1a fingerprint of the selected cards.
+     *
+     * A checkpoint can only be resumed with the catalog and selection it was taken with,
+     * any change of an issuer, length, prefix or the selection changes the fingerprint.
+     *
+     * @param catalog The catalog.
+     * @param selection_vec The selection status of every card.
+     * @return The fingerprint.
+     */
+    static unsigned long long catalog_fingerprint(const Catalog& catalog, const std::vector<bool>& selection_vec)
+    {
+        unsigned long long hash{ 14695981039346656037ULL };
+        auto feed = [&hash](std::string_view str)
+        {
+            for (char c : str)
+            {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+            hash = (hash ^ 0xff) * 1099511628211ULL;
+        };
+
+        for (int i : get_true_vec(selection_vec))
+        {
+            feed(catalog.issuer(i));
+            feed(std::to_string(catalog.length(i)));
+            feed(catalog.prefixes(i));
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Flushes a file and asks the operating system to commit it to disk.
+     *
+     * @param file The file to synchronize.
+     * @return True on success, false otherwise.
+     */
+    static bool sync_file(std::FILE* file)
+    {
+        if (std::fflush(file) != 0)
+        {
+            return false;
+        }
+#if defined(_WIN64) || defined(_WIN32)
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    /**
+     * @brief Atomically replaces the checkpoint file.
+     *
+     * The checkpoint is written to a temporary file which is synchronized and then
+     * renamed over the previous checkpoint, so a crash leaves either the old or the new one.
+     *
+     * @param path The path of the checkpoint file.
+     * @param checkpoint The checkpoint to write.
+     * @return True on success, false otherwise.
+     */
+    static bool write_checkpoint(const std::string& path, const Checkpoint& checkpoint)
+    {
+        std::string tmp_path{ path + ".tmp" };
+        std::FILE* file{ std::fopen(tmp_path.c_str(), "wb") };
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::fprintf(file, "version=1\nseed=%llu\namount=%llu\ncards=%llu\nbytes=%llu\nfingerprint=%llu\nmax_bytes=%llu\ntime_budget_ms=%llu\nelapsed_ms=%llu\n",
+            checkpoint.seed, checkpoint.amount, checkpoint.cards_emitted, checkpoint.bytes_flushed, checkpoint.fingerprint, checkpoint.max_bytes,
+            checkpoint.time_budget_ms, checkpoint.elapsed_ms);
+
+        bool ok{ sync_file(file) };
+        ok &= std::fclose(file) == 0;
+#if defined(_WIN64) || defined(_WIN32)
+        std::remove(path.c_str());
+#endif
+        return ok && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    /**
+     * @brief Reads a checkpoint file written by write_checkpoint.
+     *
+     * @param path The path of the checkpoint file.
+     * @param checkpoint Receives the checkpoint.
+     * @return True if the file exists and every field was read, false otherwise.
+     */
+    static bool read_checkpoint(const std::string& path, Checkpoint& checkpoint)
+    {
+        std::ifstream file(path);
+        std::string line{};
+        int fields{};
+
+        while (std::getline(file, line))
+        {
+            size_t eq{ line.find('=') };
+            if (eq == std::string::npos || eq + 1 == line.size())
+            {
+                continue;
+            }
+            std::string key{ line.substr(0, eq) };
+            unsigned long long value{ std::strtoull(line.c_str() + eq + 1, nullptr, 10) };
+
+            if (key == "seed") { checkpoint.seed = value; fields++; }
+            else if (key == "amount") { checkpoint.amount = value; fields++; }
+            else if (key == "cards") { checkpoint.cards_emitted = value; fields++; }
+            else if (key == "bytes") { checkpoint.bytes_flushed = value; fields++; }
+            else if (key == "fingerprint") { checkpoint.fingerprint = value; fields++; }
+            else if (key == "max_bytes") { checkpoint.max_bytes = value; }
+            else if (key == "time_budget_ms") { checkpoint.time_budget_ms = value; }
+            else if (key == "elapsed_ms") { checkpoint.elapsed_ms = value; }
+        }
+        return fields == 5;
+    }
+
+    /**
+     * @brief Opens the output of an interrupted export for appending.
+     *
+     * The file is truncated to the size recorded in the checkpoint, which discards anything
+     * written after the last durable checkpoint.
+     *
+     * @param path The path of the output file.
+     * @param checkpoint The checkpoint to resume from.
+     * @return The opened file positioned at its end, nullptr if it's missing or shorter than the checkpoint.
+     */
+    static std::FILE* open_for_resume(const std::string& path, const Checkpoint& checkpoint)
+    {
+        std::FILE* file{ std::fopen(path.c_str(), "r+b") };
+        if (file == nullptr)
+        {
+            return nullptr;
+        }
+
+#if defined(_WIN64) || defined(_WIN32)
+        bool ok{ _fseeki64(file, 0, SEEK_END) == 0 && static_cast<unsigned long long>(_ftelli64(file)) >= checkpoint.bytes_flushed &&
+            _chsize_s(_fileno(file), static_cast<long long>(checkpoint.bytes_flushed)) == 0 &&
+            _fseeki64(file, static_cast<long long>(checkpoint.bytes_flushed), SEEK_SET) == 0 };
+#else
+        bool ok{ fseeko(file, 0, SEEK_END) == 0 && static_cast<unsigned long long>(ftello(file)) >= checkpoint.bytes_flushed &&
+            ftruncate(fileno(file), static_cast<off_t>(checkpoint.bytes_flushed)) == 0 &&
+            fseeko(file, static_cast<off_t>(checkpoint.bytes_flushed), SEEK_SET) == 0 };
+#endif
+        if (ok == false)
+        {
+            std::fclose(file);
+            return nullptr;
+        }
+        return file;
+    }
+
+    /**
+     * @brief Writes the report of an export as a JSON object.
+     *
+     * Besides run, the report holds the catalog fingerprint and the size of the selection,
+     * the cards this run wrote of every issuer and every length (counted by metrics), the time spent
+     * in each stage, the CPU time of the export thread, the minimum, percentiles and maximum
+     * of the cards/s and MB/s of every sample interval (see Metrics::interval_rates) and the
+     * peak resident memory. The seed and the fingerprint are strings, a JSON number can't hold
+     * every 64-bit value.
+     *
+     * @param path The file to write, replaced if it exists.
+     * @param run What the export was asked to do and how it ended.
+     * @param catalog The catalog of the export.
+     * @param selection_vec The selected cards of the catalog.
+     * @param metrics The metrics of the export, after its last record.
+     * @return True if the report was written, false otherwise.
+     */
+    static bool write_report(const std::string& path, const RunReport& run, const Catalog& catalog, const std::vector<bool>& selection_vec, const Metrics& metrics)
+    {
+        std::string out{ "{\n" };
+        char number[64]{};
+        auto field = [&](const char* name, const std::string& value, bool last = false)
+        {
+            out += "  \"";
+            out += name;
+            out += "\": ";
+            out += value;
+            out += last ? "\n" : ",\n";
+        };
+        auto real = [&](double value)
+        {
+            std::snprintf(number, sizeof(number), "%.3f", value);
+            return std::string(number);
+        };
+        auto text = [](std::string_view value)
+        {
+            std::string quoted{};
+            append_json_string(quoted, value);
+            return quoted;
+        };
+
+        // cards written of every issuer and every length, in order of first appearance in the catalog
+        std::vector<unsigned long long> issuer_counts(catalog.issuer_count());
+        std::vector<int> lengths{};
+        std::vector<unsigned long long> length_counts{};
+        size_t selected{};
+        for (size_t i{}; i < catalog.size() && i < selection_vec.size(); i++)
+        {
+            if (selection_vec[i] == false)
+            {
+                continue;
+            }
+            selected++;
+            unsigned long long count{ metrics.card_count(i) };
+            issuer_counts[catalog.issuer_id(i)] += count;
+            size_t length{ static_cast<size_t>(std::find(lengths.begin(), lengths.end(), catalog.length(i)) - lengths.begin()) };
+            if (length == lengths.size())
+            {
+                lengths.push_back(catalog.length(i));
+                length_counts.push_back(0);
+            }
+            length_counts[length] += count;
+        }
+        std::string issuers{ "{" };
+        for (uint32_t id{}; id < issuer_counts.size(); id++)
+        {
+            if (issuer_counts[id] > 0)
+            {
+                issuers += issuers.size() > 1 ? ", " : "";
+                append_json_string(issuers, catalog.issuer_name(id));
+                issuers += ": " + std::to_string(issuer_counts[id]);
+            }
+        }
+        issuers += "}";
+        std::string lengths_str{ "{" };
+        for (size_t i{}; i < lengths.size(); i++)
+        {
+            lengths_str += (i > 0 ? ", \"" : "\"") + std::to_string(lengths[i]) + "\": " + std::to_string(length_counts[i]);
+        }
+        lengths_str += "}";
+
+        // nearest rank percentiles of the rates of the sample intervals
+        auto distribution = [&](bool bytes)
+        {
+            std::vector<float> rates{};
+            for (const std::pair<float, float>& rate : metrics.interval_rates())
+            {
+                rates.push_back(bytes ? rate.second / 1e6f : rate.first);
+            }
+            if (rates.empty())
+            {
+                return std::string("null");
+            }
+            std::sort(rates.begin(), rates.end());
+            auto percentile = [&](double p) { return real(rates[static_cast<size_t>(p * (rates.size() - 1) + 0.5)]); };
+            return "{\"min\": " + percentile(0.0) + ", \"p10\": " + percentile(0.1) + ", \"p50\": " + percentile(0.5) +
+                ", \"p90\": " + percentile(0.9) + ", \"p99\": " + percentile(0.99) + ", \"max\": " + percentile(1.0) + "}";
+        };
+
+        const Metrics::Sample& totals{ metrics.last_sample() };
+        std::snprintf(number, sizeof(number), "\"%016llx\"", catalog_fingerprint(catalog, selection_vec));
+        std::string fingerprint{ number };
+        unsigned long long written{ run.result.cards - run.start_card };
+        unsigned long long written_bytes{ run.result.bytes - run.start_bytes };
+
+        field("seed", "\"" + std::to_string(run.seed) + "\"");
+        field("rng", "{\"engine\": \"mt19937\", \"batch_cards\": " + std::to_string(batch_cards) + "}");
+        field("sink", text(run.sink));
+        field("catalog_fingerprint", fingerprint);
+        field("selection", "{\"cards\": " + std::to_string(selected) + ", \"catalog_cards\": " + std::to_string(catalog.size()) + "}");
+        field("stop", "{\"cards\": " + (run.amount == unlimited ? std::string("null") : std::to_string(run.amount)) +
+            ", \"bytes\": " + (run.max_bytes == 0 ? std::string("null") : std::to_string(run.max_bytes)) +
+            ", \"seconds\": " + (run.time_budget.count() == 0 ? std::string("null") : real(run.time_budget.count() / 1000.0)) + "}");
+        field("resumed_from", "{\"cards\": " + std::to_string(run.start_card) + ", \"bytes\": " + std::to_string(run.start_bytes) + "}");
+        field("complete", run.result.complete ? "true" : "false");
+        field("cards", std::to_string(run.result.cards));
+        field("bytes", std::to_string(run.result.bytes));
+        field("issuers", issuers);
+        field("lengths", lengths_str);
+        field("started_at", std::to_string(run.started_at));
+        field("wall_seconds", real(run.wall_seconds));
+        field("cpu_seconds", real(metrics.cpu_seconds()));
+        field("stage_seconds", "{\"generate\": " + real(totals.generate_seconds) + ", \"write\": " + real(totals.write_seconds) + ", \"wait\": " + real(totals.wait_seconds) + "}");
+        field("cards_per_second", real(run.wall_seconds > 0.0 ? written / run.wall_seconds : 0.0));
+        field("mb_per_second", real(run.wall_seconds > 0.0 ? written_bytes / run.wall_seconds / 1e6 : 0.0));
+        field("interval_seconds", real(Metrics::sample_interval));
+        field("interval_cards_per_second", distribution(false));
+        field("interval_mb_per_second", distribution(true));
+        field("peak_resident_bytes", std::to_string(Metrics::peak_resident_bytes()));
+        field("threads", "1", true);
+        out += "}\n";
+
+        std::FILE* file{ std::fopen(path.c_str(), "wb") };
+        if (file == nullptr)
+        {
+            return false;
+        }
+        bool ok{ std::fwrite(out.data(), 1, out.size(), file) == out.size() };
+        return std::fclose(file) == 0 && ok;
     }
 
     /**
      * @brief Exports a specified number of randomly selected cards to a file.
      *
      * This templated function exports a specified number of randomly selected cards from
-     * the provided vector to the given file. It uses a selection vector to determine which
-     * cards to export. The export is performed in chunks to enhance performance.
+     * the provided catalog to the given sink. It uses a selection vector to determine which
+     * cards to export.
+     *
+     * The cards are generated in batches of batch_cards, each from its own generator derived
+     * from the export seed (see batch_rng()), and every batch is written as a whole. The same
+     * seed, catalog and amount therefore always produce the same file, and an export that was
+     * stopped can continue from any batch boundary and still produce it byte for byte.
+     *
+     * If options.checkpoint_path is set, the sink is synchronized and a checkpoint is written
+     * at most every options.checkpoint_interval, and once more if the export is stopped before
+     * it completes. The checkpoint is removed when the export completes.
+     *
+     * If options.pacer is set, each batch is written in slices of whole cards and every slice
+     * waits for its tokens, so the output follows the pacer's rate profile.
+     *
+     * Besides amount, options.max_bytes and options.time_budget end the export. Both are checked
+     * once per batch (and per paced slice), the byte target cuts the last batch after the last
+     * record that fits, so the output never exceeds it and always ends on a record boundary.
+     * A resumed export counts options.start_elapsed against the time budget, so it only gets
+     * the time that was left when the checkpoint was written.
+     *
+     * If options.metrics is set, the export reports every change of its stage and the cards it
+     * writes to it, and pushes a sample of the totals after every batch (see Metrics::record).
+     *
+     * If options.report_path is set, a JSON report of the export is written there when it ends,
+     * completed or not (see write_report). The export then keeps metrics of its own if
+     * options.metrics isn't set.
+     *
+     * If options.finished is set, it's called with the result as the last step of the export,
+     * on the export thread, e.g. to tell a display that the export ended.
+     *
+     * Built with CCGEN_TRACING, the stages of the sampled batches are recorded while a Trace
+     * recording runs (see Trace::Track). The USDT probes of Probes.h mark the start and end of
+     * the export and of every batch, every write and every pause.
      *
      * @tparam T The type of the amount parameter.
-     * @param file An output file stream to write the exported cards.
-     * @param cards_vec A vector containing the cards to choose from.
+     * @param sink The output, it's finished and destroyed (a file closed) when the export ends.
+     * @param catalog The cards to choose from, the export keeps the snapshot alive until it ends.
      * @param selection_vec A vector of boolean values indicating the selection status of cards.
-     * @param amount The number of cards to export.
+     * @param amount The number of cards to export, unlimited if only bytes or time end it.
+     * @param options The seed, checkpoint settings, stop conditions and resume position of the export.
+     * @return The cards and bytes written, whether a stop condition was met and whether the report was written.
      *
      */
     template<typename T>
-    static void export_cards(std::ofstream& file, const std::vector<Card>& cards_vec, const std::vector<bool>& selection_vec, T amount)
+    static ExportResult export_cards(std::unique_ptr<Sink> sink, std::shared_ptr<const Catalog> catalog, const std::vector<bool>& selection_vec, T amount, ExportOptions options)
     {
-        constexpr int chunk = 4096;
         std::vector<int> indexes_vec{ get_true_vec(selection_vec) };
-        std::ostringstream oss(std::ios_base::ate);
-        T size{};
-        int rnd_idx{};
-        T i;
-        for (i = 0; i < amount; i++)
+        const unsigned long long total{ static_cast<unsigned long long>(amount) };
+        const bool checkpoints{ options.checkpoint_path.empty() == false };
+
+        Checkpoint checkpoint{};
+        checkpoint.seed = options.seed;
+        checkpoint.amount = total;
+        checkpoint.cards_emitted = options.start_card;
+        checkpoint.bytes_flushed = options.start_bytes;
+        checkpoint.fingerprint = checkpoints ? catalog_fingerprint(*catalog, selection_vec) : 0;
+        checkpoint.max_bytes = options.max_bytes;
+        checkpoint.time_budget_ms = static_cast<unsigned long long>(options.time_budget.count());
+
+        unsigned long long emitted{ options.start_card };
+        unsigned long long bytes{ options.start_bytes };
+        auto last_checkpoint{ std::chrono::steady_clock::now() };
+        auto active_start{ std::chrono::steady_clock::now() - options.start_elapsed };     // moved forward by pauses, now - active_start is the unpaused time
+        auto deadline{ active_start + options.time_budget };
+        const bool track_ends{ options.pacer != nullptr || options.max_bytes > 0 };
+        bool complete{ emitted == total };
+        std::string buffer{};
+        std::string skipped{};
+        std::vector<size_t> card_ends{};
+        const bool report{ options.report_path.empty() == false };
+        bool report_written{};
+        if (report && options.metrics == nullptr)
+        {
+            options.metrics = std::make_shared<Metrics>(catalog->size());
+        }
+        Metrics* metrics{ options.metrics.get() };
+        RunReport run{ options.seed, total, options.max_bytes, options.time_budget, options.start_card, options.start_bytes, sink->name(),
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() };
+        auto started{ std::chrono::steady_clock::now() };
+        const bool sink_cards{ sink->wants_cards() };
+        const bool track_cards{ sink_cards || metrics != nullptr };
+        std::vector<int> card_ids{};
+        if (metrics != nullptr)
+        {
+            metrics->start();
+        }
+
+#if defined(CCGEN_TRACING)
+        Trace::Track track{};
+#endif
+
+        // reports a change of stage to metrics and to the trace
+        auto enter = [&](Metrics::Stage stage)
+        {
+            if (metrics != nullptr)
+            {
+                metrics->enter(stage);
+            }
+#if defined(CCGEN_TRACING)
+            track.enter(Metrics::stage_name(stage));
+#endif
+        };
+
+        // unpaused time of the export in milliseconds, including the time before a resume
+        auto active_ms = [&]()
+        {
+            return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - active_start).count());
+        };
+
+        // fraction of the export done, by whichever stop condition is closest
+        auto progress = [&]()
+        {
+            double fraction{ static_cast<double>(emitted) / total };
+            if (options.max_bytes > 0)
+            {
+                fraction = std::max(fraction, static_cast<double>(bytes) / options.max_bytes);
+            }
+            if (options.time_budget.count() > 0)
+            {
+                auto left{ std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()) };
+                fraction = std::max(fraction, 1.0 - static_cast<double>(left.count()) / options.time_budget.count());
+            }
+            return static_cast<float>(std::min(fraction, 1.0));
+        };
+
+        CCGEN_PROBE3(export__start, options.seed, total, options.start_card);
+        while (complete == false)
         {
-            while (g_paused)
+#if defined(CCGEN_TRACING)
+            track.batch(emitted / batch_cards);
+#endif
+            auto pause_start{ std::chrono::steady_clock::now() };
+            if (g_paused)
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
-                if (g_started == false)
+                CCGEN_PROBE1(pause, emitted);
+                while (g_paused)
                 {
-                    break;
+                    enter(Metrics::Stage::paused);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                    if (g_started == false)
+                    {
+                        break;
+                    }
                 }
+                CCGEN_PROBE1(resume, emitted);
             }
+            // paused time doesn't count against the budget
+            auto paused_for{ std::chrono::steady_clock::now() - pause_start };
+            active_start += paused_for;
+            deadline += paused_for;
             if (g_started == false)
             {
                 break;
             }
-            rnd_idx = choose_random_index(indexes_vec);
-            cards_vec[rnd_idx].generate_card(oss);
+            if (options.time_budget.count() > 0 && std::chrono::steady_clock::now() >= deadline)
+            {
+                complete = true;
+                break;
+            }
+
+            // regenerate the current batch from its start, only the cards after emitted are kept
+            unsigned long long batch{ emitted / batch_cards };
+            unsigned long long batch_end{ std::min((batch + 1) * batch_cards, total) };
+            std::mt19937 rng{ batch_rng(options.seed, batch) };
+            enter(Metrics::Stage::generating);
+            CCGEN_PROBE2(batch__start, batch, emitted);
 
-            // write chunk to file
-            if (oss.tellp() > chunk)
+            buffer.clear();
+            card_ends.clear();
+            card_ids.clear();
+            for (unsigned long long i{ batch * batch_cards }; i < batch_end; i++)
             {
-                // Extract and write the first "chunk" bytes
-                file << oss.str().substr(0, chunk);
+                if (i < emitted)
+                {
+                    // already in the file, generated only to keep rng in step
+                    skipped.clear();
+                    catalog->generate_card(choose_random_index(indexes_vec, rng), skipped, rng);
+                    continue;
+                }
+                if (i > 0)
+                {
+                    buffer += '\n';
+                }
+                int index{ choose_random_index(indexes_vec, rng) };
+                catalog->generate_card(index, buffer, rng);
+                if (track_ends)
+                {
+                    card_ends.push_back(buffer.size());
+                }
+                if (track_cards)
+                {
+                    card_ids.push_back(index);
+                }
+            }
 
-                // Remove the bytes from the stringstream
-                oss.str(oss.str().substr(chunk));
+            // cut the batch after the last record that fits in the byte target, the export is
+            // complete only once the whole cut batch was written
+            unsigned long long batch_count{ batch_end - emitted };
+            bool byte_target_hit{};
+            if (options.max_bytes > 0 && bytes + buffer.size() >= options.max_bytes)
+            {
+                batch_count = static_cast<unsigned long long>(std::upper_bound(card_ends.begin(), card_ends.end(), options.max_bytes - bytes) - card_ends.begin());
+                buffer.resize(batch_count > 0 ? card_ends[batch_count - 1] : 0);
+                byte_target_hit = true;
+            }
+            CCGEN_PROBE3(batch__generated, batch, batch_count, buffer.size());
 
-                // update the progress bar value
-                g_progress = static_cast<float>(i) / amount;
+            // write the batch, a paced export writes it in slices of whole cards
+            unsigned long long written{};
+            size_t offset{};
+            bool ok{ true };
+            while (written < batch_count)
+            {
+                unsigned long long slice{ batch_count - written };
+                size_t end{ buffer.size() };
+                if (options.time_budget.count() > 0 && written > 0 && std::chrono::steady_clock::now() >= deadline)
+                {
+                    complete = true;
+                    break;
+                }
+                if (options.pacer != nullptr)
+                {
+                    slice = std::min(slice, options.pacer->slice_cards(batch_cards));
+                    enter(Metrics::Stage::waiting);
+                    if (options.pacer->acquire(slice, g_started, g_paused) == false)
+                    {
+                        break;
+                    }
+                    end = card_ends[written + slice - 1];
+                }
+                enter(Metrics::Stage::writing);
+                if (sink_cards)
+                {
+                    sink->next_cards(card_ids.data() + written, static_cast<size_t>(slice));
+                }
+                CCGEN_PROBE3(write__start, batch, slice, end - offset);
+                ok = sink->write(buffer.data() + offset, end - offset);
+                CCGEN_PROBE3(write__done, batch, end - offset, ok ? 1 : 0);
+                if (ok == false)
+                {
+                    break;
+                }
+                if (metrics != nullptr)
+                {
+                    metrics->count_cards(card_ids.data() + written, static_cast<size_t>(slice));
+                }
+                bytes += end - offset;
+                offset = end;
+                written += slice;
             }
-        }
+            emitted += written;
+            complete = ok && (complete || (byte_target_hit && written == batch_count) || emitted == total);
 
-        // Write any remaining content in the stringstream
-        if (g_started)
-        {
-            // int size = oss.tellp();
-            std::streamoff size = oss.tellp();
+            // update the progress bar value
+            g_progress = complete ? 1.0f : progress();
+            if (metrics != nullptr)
+            {
+                metrics->record(emitted, bytes, false);
+            }
+
+            if (ok == false || complete || written < batch_count)
+            {
+                break;
+            }
 
-            if (size > 0)
+            if (checkpoints && std::chrono::steady_clock::now() - last_checkpoint >= options.checkpoint_interval && sink->sync())
             {
-                size -= 1;
-                oss.str(oss.str().substr(0, size));
+                checkpoint.cards_emitted = emitted;
+                checkpoint.bytes_flushed = bytes;
+                checkpoint.elapsed_ms = active_ms();
+                write_checkpoint(options.checkpoint_path, checkpoint);
+                last_checkpoint = std::chrono::steady_clock::now();
             }
-            file << oss.str();
-            g_progress = static_cast<float>(i) / amount;
         }
 
-        file.close();
+        // keep a final checkpoint of a stopped export, drop it once the export is complete
+        if (checkpoints && complete == false && sink->sync())
+        {
+            checkpoint.cards_emitted = emitted;
+            checkpoint.bytes_flushed = bytes;
+            checkpoint.elapsed_ms = active_ms();
+            write_checkpoint(options.checkpoint_path, checkpoint);
+        }
+        enter(Metrics::Stage::writing);
+        complete = sink->finish() && complete;
+        sink.reset();
+        enter(Metrics::Stage::finished);
+        CCGEN_PROBE3(export__end, emitted, bytes, complete ? 1 : 0);
+        if (metrics != nullptr)
+        {
+            metrics->record(emitted, bytes, true);
+        }
+        if (report)
+        {
+            run.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            run.result = ExportResult{ emitted, bytes, complete };
+            report_written = write_report(options.report_path, run, *catalog, selection_vec, *metrics);
+        }
+        if (checkpoints && complete)
+        {
+            std::remove(options.checkpoint_path.c_str());
+        }
+
         g_started = false;
+        ExportResult result{ emitted, bytes, complete, report_written };
+        if (options.finished)
+        {
+            options.finished(result);
+        }
+        return result;
     }
 
     /**
@@ -245,7 +1108,17 @@ public:
     template <typename T>
     static inline std::string estimate_size(T amount)
     {
-        double size{ amount * static_cast<double>(std::string("11111111111111111111111111111111\n").size()) };
+        return format_size(amount * static_cast<double>(typical_record_bytes));
+    }
+
+    /**
+     * @brief Formats a number of bytes in a human-readable unit.
+     *
+     * @param size The number of bytes.
+     * @return The size as "<value> [<unit>]", e.g. "1.500000 [KB]".
+     */
+    static inline std::string format_size(double size)
+    {
         static std::array<const char*, 5> sizes{ "B", "KB", "MB", "GB", "TB" };
         size_t si{};
 
@@ -0,0 +1,556 @@
+#include "Importer.h"
+#include "DB_API.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+/**
+ * @class RecordReader
+ * @brief Splits a CSV/TSV file into records and fields without copying them.
+ *
+ * The file is read in chunks into one buffer, a record is located with memchr and only
+ * scanned character by character if it contains quotes (quoted fields may contain the
+ * delimiter, newlines and "" escapes). Fields point into the buffer and stay valid until
+ * the next call to next().
+ */
+class RecordReader
+{
+public:
+	struct Field
+	{
+		const char* data;
+		size_t size;
+	};
+
+	RecordReader(std::FILE* file, char delimiter) : m_file{ file }, m_delimiter{ delimiter }, m_buffer(chunk_size) {}
+
+	// Reads the next non-empty record into fields, returns false at the end of the file.
+	bool next(std::vector<Field>& fields);
+
+	// The raw text of the current record and the line it starts on.
+	const char* record() const { return m_record; }
+	size_t record_size() const { return m_record_size; }
+	unsigned long long line() const { return m_line; }
+
+private:
+	bool fill();
+	void split(std::vector<Field>& fields);
+
+	static constexpr size_t chunk_size{ 1 << 20 };
+
+	std::FILE* m_file;
+	char m_delimiter;
+	std::vector<char> m_buffer;
+	size_t m_begin{};
+	size_t m_end{};
+	bool m_eof{ false };
+	bool m_first{ true };
+	const char* m_record{};
+	size_t m_record_size{};
+	unsigned long long m_line{};
+	unsigned long long m_next_line{ 1 };
+	std::vector<std::string> m_unescaped{};
+};
+
+/**
+ * @brief Moves the unread bytes to the start of the buffer and reads more of the file.
+ *
+ * The buffer grows if a single record doesn't fit in it.
+ *
+ * @return False if nothing more could be read.
+ */
+bool RecordReader::fill()
+{
+	if (m_eof)
+	{
+		return false;
+	}
+	if (m_begin > 0)
+	{
+		std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+		m_end -= m_begin;
+		m_begin = 0;
+	}
+	if (m_end == m_buffer.size())
+	{
+		m_buffer.resize(m_buffer.size() * 2);
+	}
+
+	size_t read{ std::fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file) };
+	m_end += read;
+	if (read == 0)
+	{
+		m_eof = true;
+	}
+
+	// skip a UTF-8 byte order mark
+	if (m_first && m_end >= 3 && std::memcmp(m_buffer.data(), "\xEF\xBB\xBF", 3) == 0)
+	{
+		m_begin = 3;
+	}
+	m_first = m_first && m_end < 3 && m_eof == false;
+	return read > 0;
+}
+
+/**
+ * @brief Reads the next non-empty record.
+ *
+ * @param fields Receives the fields of the record.
+ * @return True if a record was read, false at the end of the file.
+ */
+bool RecordReader::next(std::vector<Field>& fields)
+{
+	while (true)
+	{
+		const char* begin{ m_buffer.data() + m_begin };
+		const char* end{ m_buffer.data() + m_end };
+		const char* newline{ static_cast<const char*>(std::memchr(begin, '\n', end - begin)) };
+
+		// a quoted field can contain newlines, find the newline outside of quotes
+		if (std::memchr(begin, '"', (newline != nullptr ? newline : end) - begin) != nullptr)
+		{
+			bool quoted{ false };
+			newline = nullptr;
+			for (const char* it{ begin }; it != end; it++)
+			{
+				if (*it == '"')
+				{
+					quoted = !quoted;
+				}
+				else if (*it == '\n' && quoted == false)
+				{
+					newline = it;
+					break;
+				}
+			}
+		}
+
+		if (newline == nullptr && m_eof == false)
+		{
+			fill();
+			continue;
+		}
+		if (newline == nullptr && begin == end)
+		{
+			return false;
+		}
+
+		const char* record_end{ newline != nullptr ? newline : end };
+		m_begin = (newline != nullptr ? newline + 1 : end) - m_buffer.data();
+		m_line = m_next_line;
+		m_next_line += 1 + std::count(begin, record_end, '\n');
+
+		m_record = begin;
+		m_record_size = record_end - begin;
+		if (m_record_size > 0 && m_record[m_record_size - 1] == '\r')
+		{
+			m_record_size--;
+		}
+		if (m_record_size > 0)
+		{
+			split(fields);
+			return true;
+		}
+	}
+}
+
+/**
+ * @brief Splits the current record into fields.
+ *
+ * Quotes around a field are removed, only a field with "" escapes is copied to unescape it.
+ *
+ * @param fields Receives the fields of the record.
+ */
+void RecordReader::split(std::vector<Field>& fields)
+{
+	fields.clear();
+	const char* it{ m_record };
+	const char* end{ m_record + m_record_size };
+	size_t unescaped{};
+
+	while (true)
+	{
+		Field field{ it, 0 };
+		if (it != end && *it == '"')
+		{
+			const char* start{ ++it };
+			bool escaped{ false };
+			while (it != end && (*it != '"' || (it + 1 != end && it[1] == '"')))
+			{
+				escaped |= *it == '"';
+				it += *it == '"' ? 2 : 1;
+			}
+			field = Field{ start, static_cast<size_t>(it - start) };
+			if (escaped)
+			{
+				if (m_unescaped.size() <= unescaped)
+				{
+					m_unescaped.emplace_back();
+				}
+				std::string& copy{ m_unescaped[unescaped++] };
+				copy.clear();
+				for (const char* c{ start }; c != it; c++)
+				{
+					copy += *c;
+					c += *c == '"';
+				}
+				field = Field{ copy.data(), copy.size() };
+			}
+			// skip the closing quote and anything up to the delimiter
+			while (it != end && *it != m_delimiter)
+			{
+				it++;
+			}
+		}
+		else
+		{
+			const char* delimiter{ static_cast<const char*>(std::memchr(it, m_delimiter, end - it)) };
+			it = delimiter != nullptr ? delimiter : end;
+			field.size = it - field.data;
+		}
+
+		fields.push_back(field);
+		if (it == end)
+		{
+			return;
+		}
+		it++;
+	}
+}
+
+/**
+ * @brief Removes leading and trailing spaces and tabs from a field.
+ */
+static RecordReader::Field trim(RecordReader::Field field)
+{
+	while (field.size > 0 && (*field.data == ' ' || *field.data == '\t'))
+	{
+		field.data++;
+		field.size--;
+	}
+	while (field.size > 0 && (field.data[field.size - 1] == ' ' || field.data[field.size - 1] == '\t'))
+	{
+		field.size--;
+	}
+	return field;
+}
+
+/**
+ * @brief Writes a rejected record to the rejects report as "line,reason,record".
+ */
+static void write_reject(std::FILE* rejects, const RecordReader& reader, const char* reason)
+{
+	if (rejects == nullptr)
+	{
+		return;
+	}
+	std::fprintf(rejects, "%llu,%s,\"", reader.line(), reason);
+	for (size_t i{}; i < reader.record_size(); i++)
+	{
+		if (reader.record()[i] == '"')
+		{
+			std::fputc('"', rejects);
+		}
+		std::fputc(reader.record()[i], rejects);
+	}
+	std::fputs("\"\n", rejects);
+}
+
+/**
+ * @brief Parses a column mapping.
+ *
+ * The mapping is a comma-separated list of issuer=COLUMN, length=COLUMN and prefixes=COLUMN,
+ * where COLUMN is a 1-based index or the name of the column in the header. Fields that are
+ * not mentioned keep their current column.
+ *
+ * @param str The mapping to parse.
+ * @param options Receives the columns.
+ * @return True if str is a valid mapping, false otherwise.
+ */
+bool Importer::parse_columns(const std::string& str, Options& options)
+{
+	size_t begin{};
+	while (begin <= str.size())
+	{
+		size_t end{ std::min(str.find(',', begin), str.size()) };
+		std::string pair{ str.substr(begin, end - begin) };
+		size_t equals{ pair.find('=') };
+		if (equals == std::string::npos || equals + 1 == pair.size())
+		{
+			return false;
+		}
+
+		std::string key{ pair.substr(0, equals) };
+		std::string column{ pair.substr(equals + 1) };
+		if (column.find_first_not_of("0123456789") == std::string::npos && (column.size() > 4 || std::stoi(column) == 0))
+		{
+			return false;
+		}
+		if (key == "issuer")
+		{
+			options.issuer_column = column;
+		}
+		else if (key == "length")
+		{
+			options.length_column = column;
+		}
+		else if (key == "prefixes")
+		{
+			options.prefixes_column = column;
+		}
+		else
+		{
+			return false;
+		}
+		begin = end + 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Imports a CSV or TSV file of BIN ranges into the catalog.
+ *
+ * Every record holds an issuer, a card length (or options.length is used) and prefixes
+ * in the format of Card::validate_prefix, e.g. "Visa,16,4" or "Mastercard,16,\"51-55,2221-2720\"".
+ * Valid records are added to the catalog, ranges that already exist are counted but left
+ * as they are. Invalid records are counted and written to the rejects report.
+ *
+ * The ranges are inserted with cached prepared statements and a transaction is committed
+ * every options.batch_rows records. If a database error stops the import, the current
+ * batch is rolled back and the batches committed before it stay in the catalog.
+ *
+ * @param db The catalog session, opened read-write.
+ * @param path The path of the file to import.
+ * @param options The delimiter, the column mapping and the batch size.
+ * @param result Receives the counters of the import.
+ * @param err_msg A string reference to store error messages, if any.
+ * @return An SQLite error code. SQLITE_OK if successful, otherwise an error code.
+ */
+int Importer::import_file(std::shared_ptr<CatalogDb> db, const std::string& path, const Options& options, Result& result, std::string& err_msg)
+{
+	result = Result{};
+	std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{ std::fopen(path.c_str(), "rb"), std::fclose };
+	if (file == nullptr)
+	{
+		err_msg = "Couldn't open the file \"" + path + "\"";
+		return SQLITE_CANTOPEN;
+	}
+	std::unique_ptr<std::FILE, int(*)(std::FILE*)> rejects{ nullptr, std::fclose };
+	if (options.rejects_path.empty() == false)
+	{
+		rejects.reset(std::fopen(options.rejects_path.c_str(), "wb"));
+		if (rejects == nullptr)
+		{
+			err_msg = "Couldn't open the file \"" + options.rejects_path + "\"";
+			return SQLITE_CANTOPEN;
+		}
+		std::fputs("line,reason,record\n", rejects.get());
+	}
+
+	RecordReader reader{ file.get(), options.delimiter };
+	std::vector<RecordReader::Field> fields{};
+
+	// resolve the columns, names are looked up in the header
+	auto is_index = [](const std::string& column) { return column.empty() || column.find_first_not_of("0123456789") == std::string::npos; };
+	bool by_name{ (is_index(options.issuer_column) && is_index(options.length_column) && is_index(options.prefixes_column)) == false };
+	if ((options.header || by_name) && reader.next(fields) == false)
+	{
+		err_msg = "The file is empty";
+		return SQLITE_EMPTY;
+	}
+	auto resolve = [&](const std::string& column, int& index) -> bool
+	{
+		index = -1;
+		if (is_index(column))
+		{
+			index = column.empty() ? -1 : std::stoi(column) - 1;
+			return true;
+		}
+		for (size_t i{}; i < fields.size(); i++)
+		{
+			RecordReader::Field name{ trim(fields[i]) };
+			if (name.size == column.size() && std::equal(column.begin(), column.end(), name.data,
+				[](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); }))
+			{
+				index = static_cast<int>(i);
+				return true;
+			}
+		}
+		err_msg = "The header has no column \"" + column + "\"";
+		return false;
+	};
+	int issuer_index{};
+	int length_index{};
+	int prefixes_index{};
+	if (resolve(options.issuer_column, issuer_index) == false || resolve(options.length_column, length_index) == false ||
+		resolve(options.prefixes_column, prefixes_index) == false)
+	{
+		return SQLITE_ERROR;
+	}
+	if (length_index < 0 && Card::validate_length(options.length) == false)
+	{
+		err_msg = "Without a length column every row needs a valid length";
+		return SQLITE_ERROR;
+	}
+	size_t min_fields{ static_cast<size_t>(std::max(issuer_index, std::max(length_index, prefixes_index))) + 1 };
+
+	int rc{ DB_API::create_tables(db, err_msg) };
+	if (rc != SQLITE_OK)
+	{
+		return rc;
+	}
+	CatalogDb::Statement select_issuer{ db->prepare("SELECT id FROM issuers WHERE name = ?1;", rc) };
+	CatalogDb::Statement insert_issuer{ db->prepare("INSERT INTO issuers (name) VALUES (?1);", rc) };
+	CatalogDb::Statement insert_range{ db->prepare("INSERT INTO ranges (issuer_id, length, lo, hi) VALUES (?1, ?2, ?3, ?4) ON CONFLICT DO NOTHING;", rc) };
+	if ((select_issuer && insert_issuer && insert_range) == false)
+	{
+		err_msg = "Error preparing insert statement: " + db->errmsg();
+		return rc != SQLITE_OK ? rc : SQLITE_ERROR;
+	}
+	if ((rc = db->exec("BEGIN IMMEDIATE;")) != SQLITE_OK)
+	{
+		err_msg = "Failed to begin a transaction: " + db->errmsg();
+		return rc;
+	}
+
+	// returns the id of an issuer, adding it to the catalog if it's new
+	std::unordered_map<std::string, sqlite3_int64> issuer_ids{};
+	std::string issuer{};
+	sqlite3_int64 issuer_id{ -1 };
+	auto find_issuer = [&](const RecordReader::Field& name) -> int
+	{
+		// BIN lists are usually grouped by issuer, so the previous row's issuer is checked first
+		if (issuer_id != -1 && issuer.size() == name.size && std::memcmp(issuer.data(), name.data, name.size) == 0)
+		{
+			return SQLITE_OK;
+		}
+		issuer.assign(name.data, name.size);
+		auto it = issuer_ids.find(issuer);
+		if (it != issuer_ids.end())
+		{
+			issuer_id = it->second;
+			return SQLITE_OK;
+		}
+
+		sqlite3_bind_text(select_issuer.get(), 1, issuer.data(), static_cast<int>(issuer.size()), SQLITE_STATIC);
+		int step_rc{ sqlite3_step(select_issuer.get()) };
+		if (step_rc == SQLITE_ROW)
+		{
+			issuer_id = sqlite3_column_int64(select_issuer.get(), 0);
+		}
+		sqlite3_reset(select_issuer.get());
+		if (step_rc == SQLITE_DONE)
+		{
+			sqlite3_bind_text(insert_issuer.get(), 1, issuer.data(), static_cast<int>(issuer.size()), SQLITE_STATIC);
+			step_rc = sqlite3_step(insert_issuer.get());
+			sqlite3_reset(insert_issuer.get());
+			issuer_id = sqlite3_last_insert_rowid(db->handle());
+		}
+		if (step_rc != SQLITE_ROW && step_rc != SQLITE_DONE)
+		{
+			issuer_id = -1;
+			return step_rc;
+		}
+		issuer_ids.emplace(issuer, issuer_id);
+		return SQLITE_OK;
+	};
+
+	std::vector<std::pair<int, int>> ranges{};
+	unsigned long long batch{};
+	while (reader.next(fields))
+	{
+		result.records++;
+		if (fields.size() < min_fields)
+		{
+			result.rejected++;
+			write_reject(rejects.get(), reader, "missing columns");
+			continue;
+		}
+
+		RecordReader::Field name{ trim(fields[issuer_index]) };
+		if (name.size == 0)
+		{
+			result.rejected++;
+			write_reject(rejects.get(), reader, "invalid issuer");
+			continue;
+		}
+
+		int length{ options.length };
+		if (length_index >= 0)
+		{
+			RecordReader::Field length_field{ trim(fields[length_index]) };
+			bool digits{ length_field.size > 0 && length_field.size <= 2 };
+			length = 0;
+			for (size_t i{}; digits && i < length_field.size; i++)
+			{
+				digits = length_field.data[i] >= '0' && length_field.data[i] <= '9';
+				length = length * 10 + (length_field.data[i] - '0');
+			}
+			length = digits ? length : 0;
+		}
+		if (Card::validate_length(length) == false)
+		{
+			result.rejected++;
+			write_reject(rejects.get(), reader, "invalid length");
+			continue;
+		}
+
+		const RecordReader::Field& prefixes{ fields[prefixes_index] };
+		Card::PrefixError error{};
+		if (Card::parse_prefixes(std::string_view(prefixes.data, prefixes.size), length, ranges, &error) == false)
+		{
+			result.rejected++;
+			std::string reason{ "invalid prefixes (" + std::string(error.message) + " at position " + std::to_string(error.position + 1) + ")" };
+			write_reject(rejects.get(), reader, reason.c_str());
+			continue;
+		}
+
+		if ((rc = find_issuer(name)) != SQLITE_OK)
+		{
+			break;
+		}
+		for (const auto& range : ranges)
+		{
+			sqlite3_bind_int64(insert_range.get(), 1, issuer_id);
+			sqlite3_bind_int(insert_range.get(), 2, length);
+			sqlite3_bind_int(insert_range.get(), 3, range.first);
+			sqlite3_bind_int(insert_range.get(), 4, range.second);
+			rc = sqlite3_step(insert_range.get());
+			sqlite3_reset(insert_range.get());
+			if (rc != SQLITE_DONE)
+			{
+				break;
+			}
+			rc = SQLITE_OK;
+			if (sqlite3_changes(db->handle()) > 0)
+			{
+				result.ranges++;
+			}
+			else
+			{
+				result.existing++;
+			}
+		}
+		if (rc != SQLITE_OK)
+		{
+			break;
+		}
+
+		if (++batch == options.batch_rows)
+		{
+			batch = 0;
+			if ((rc = db->exec("COMMIT; BEGIN IMMEDIATE;")) != SQLITE_OK)
+			{
+				break;
+			}
+		}
+	}
+
+	if (rc != SQLITE_OK || (rc = db->exec("COMMIT;")) != SQLITE_OK)
+	{
+		err_msg = "Failed to import line " + std::to_string(reader.line()) + ": " + db->errmsg();
+		db->exec("ROLLBACK;");
+	}
+	return rc;
+}
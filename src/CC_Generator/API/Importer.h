@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "CatalogDb.h"
+
+/**
+ * @class Importer
+ * @brief Bulk import of BIN lists from CSV or TSV files into the catalog.
+ *
+ * The file is read in large chunks and split into records in place, fields point into
+ * the read buffer and are only copied when they contain escaped quotes. Every record is
+ * validated with Card::parse_prefixes and its ranges are added to the catalog with
+ * prepared statements, committing every batch_rows records, so millions of rows import
+ * in seconds. Ranges that are already in the catalog are left as they are.
+ *
+ * Records that can't be imported are written to an optional rejects report (CSV with the
+ * line number, the reason and the original record) and don't stop the import.
+ */
+class Importer
+{
+public:
+	// Maps the columns of the file to the fields of a card.
+	struct Options
+	{
+		char delimiter{ ',' };			// ',' for CSV, '\t' for TSV.
+		bool header{ false };			// Skip the first record (implied by column names).
+		std::string issuer_column{ "1" };	// 1-based index or header name.
+		std::string length_column{ "2" };	// 1-based index or header name, empty to use length.
+		std::string prefixes_column{ "3" };	// 1-based index or header name.
+		int length{};					// Card length of every row if there is no length column.
+		unsigned long long batch_rows{ 100000 };	// Records per transaction.
+		std::string rejects_path{};		// Where to report rejected records, empty for none.
+	};
+
+	// Counters of an import.
+	struct Result
+	{
+		unsigned long long records{};	// Data records read (excluding the header).
+		unsigned long long ranges{};	// Ranges added to the catalog.
+		unsigned long long existing{};	// Ranges that were already in the catalog.
+		unsigned long long rejected{};	// Records that were rejected.
+	};
+
+	// Parses a column mapping such as "issuer=1,length=2,prefixes=3" or "issuer=brand,prefixes=bin" into options.
+	static bool parse_columns(const std::string& str, Options& options);
+
+	// Imports the file at path into the catalog of db.
+	static int import_file(std::shared_ptr<CatalogDb> db, const std::string& path, const Options& options, Result& result, std::string& err_msg);
+
+	Importer() = delete;
+};
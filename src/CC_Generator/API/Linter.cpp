@@ -0,0 +1,303 @@
+#include "Linter.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+/**
+ * @struct LintSpan
+ * @brief A span of a range (see Card::split_range) and where the range is in the catalog.
+ */
+struct LintSpan : Card::Span
+{
+	int len{};					// Length of the card.
+	size_t issuer{};			// Interned issuer name.
+	size_t card{};				// Where the range is in the catalog.
+	size_t range{};
+};
+
+/**
+ * @brief Counts the decimal digits of a positive number.
+ */
+static int count_digits(long long value)
+{
+	int digits{ 1 };
+	while (value >= 10)
+	{
+		value /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+/**
+ * @brief Splits a range into spans that copy the fields of proto.
+ *
+ * @param range The prefix range.
+ * @param proto The fields every span copies (card, range, issuer and length).
+ * @param spans The vector to append the spans to.
+ */
+static void split_range(const std::pair<int, int>& range, const LintSpan& proto, std::vector<LintSpan>& spans)
+{
+	std::vector<Card::Span> parts{};
+	Card::split_range(range, parts);
+	for (const auto& part : parts)
+	{
+		LintSpan span{ proto };
+		static_cast<Card::Span&>(span) = part;
+		spans.push_back(span);
+	}
+}
+
+/**
+ * @brief Orders spans by the first covered number, the wider span first when two start together.
+ */
+static bool span_less(const LintSpan& a, const LintSpan& b)
+{
+	if (a.lo != b.lo)
+	{
+		return a.lo < b.lo;
+	}
+	return a.hi > b.hi;
+}
+
+/**
+ * @brief Analyzes the prefix ranges of a catalog.
+ *
+ * The ranges are split into spans, sorted by card length and first covered number and swept
+ * once. Each span is compared with the furthest-reaching earlier span of its own issuer
+ * (duplicates, shadowed, partially overlapping and adjacent ranges), so a conflict with an own
+ * range that reaches less far isn't reported separately. The sweep also keeps the earlier spans
+ * that still reach the current one, ordered by their last number: the ones that end before it
+ * are dropped and every remaining span of another issuer is reported (overlaps between
+ * issuers). That reports every overlapping pair of issuers in O(n log n + k), k being the
+ * overlapping pairs. Only cards of the same length are compared, a 16 and a 19 digit card with
+ * the same prefix don't conflict. Every range is also checked against the length of its card.
+ *
+ * @param cards The catalog.
+ * @return The findings, ordered by card and range.
+ */
+std::vector<Linter::Finding> Linter::lint(const std::vector<Card>& cards)
+{
+	std::vector<Finding> findings{};
+	std::vector<LintSpan> spans{};
+	std::unordered_map<std::string, size_t> issuers{};
+
+	for (size_t i{}; i < cards.size(); i++)
+	{
+		LintSpan proto{};
+		proto.card = i;
+		proto.len = cards[i].get_len();
+		proto.issuer = issuers.emplace(cards[i].get_issuer(), issuers.size()).first->second;
+
+		const auto& ranges{ cards[i].get_ranges() };
+		for (size_t j{}; j < ranges.size(); j++)
+		{
+			if (count_digits(ranges[j].second) >= proto.len)
+			{
+				findings.push_back(Finding{ Kind::too_long, i, j });
+			}
+			proto.range = j;
+			split_range(ranges[j], proto, spans);
+		}
+	}
+
+	std::sort(spans.begin(), spans.end(), [](const LintSpan& a, const LintSpan& b) { return a.len != b.len ? a.len < b.len : span_less(a, b); });
+
+	auto report = [&findings](Kind kind, const LintSpan& span, const LintSpan& other)
+	{
+		if (span.card != other.card || span.range != other.range)
+		{
+			findings.push_back(Finding{ kind, span.card, span.range, other.card, other.range });
+		}
+	};
+
+	std::unordered_map<size_t, size_t> own{};	// Issuer -> its furthest span.
+	std::multimap<unsigned long long, size_t> active{};	// The earlier spans that reach the current one, by their last number.
+	for (size_t i{}; i < spans.size(); i++)
+	{
+		const LintSpan& span{ spans[i] };
+		if (i == 0 || spans[i - 1].len != span.len)
+		{
+			own.clear();
+			active.clear();
+		}
+
+		auto it = own.find(span.issuer);
+		if (it == own.end())
+		{
+			own.emplace(span.issuer, i);
+		}
+		else
+		{
+			const LintSpan& cover{ spans[it->second] };
+			if (span.lo <= cover.hi)
+			{
+				report(span.lo == cover.lo && span.hi == cover.hi ? Kind::duplicate : span.hi <= cover.hi ? Kind::shadowed : Kind::overlap, span, cover);
+			}
+			else if (span.lo == cover.hi + 1 && span.digits == cover.digits && span.card == cover.card)
+			{
+				report(Kind::adjacent, span, cover);
+			}
+			if (span.hi > cover.hi)
+			{
+				it->second = i;
+			}
+		}
+
+		// the spans that end before this one can't reach any later span, every other one overlaps it
+		active.erase(active.begin(), active.lower_bound(span.lo));
+		for (const auto& open : active)
+		{
+			if (spans[open.second].issuer != span.issuer)
+			{
+				report(Kind::overlap, span, spans[open.second]);
+			}
+		}
+		active.emplace(span.hi, i);
+	}
+
+	// a range split into several spans may report the same conflict more than once
+	auto key = [](const Finding& f) { return std::make_tuple(f.card, f.range, f.kind, f.other_card, f.other_range); };
+	std::sort(findings.begin(), findings.end(), [&key](const Finding& a, const Finding& b) { return key(a) < key(b); });
+	findings.erase(std::unique(findings.begin(), findings.end(), [&key](const Finding& a, const Finding& b) { return key(a) == key(b); }), findings.end());
+	return findings;
+}
+
+/**
+ * @brief Describes a finding in one line, e.g. "Visa (16) 4571 is shadowed by Visa (16) 4".
+ *
+ * @param cards The catalog that was analyzed.
+ * @param finding A finding of lint(cards).
+ * @return The description.
+ */
+std::string Linter::describe(const std::vector<Card>& cards, const Finding& finding)
+{
+	auto name = [&cards](size_t card, size_t range)
+	{
+		return cards[card].get_issuer() + " (" + std::to_string(cards[card].get_len()) + ") " + Card::format_ranges({ cards[card].get_ranges()[range] });
+	};
+
+	std::string range{ name(finding.card, finding.range) };
+	switch (finding.kind)
+	{
+	case Kind::overlap:
+		return range + " overlaps " + name(finding.other_card, finding.other_range);
+	case Kind::duplicate:
+		return range + " duplicates " + name(finding.other_card, finding.other_range);
+	case Kind::shadowed:
+		return range + " is shadowed by " + name(finding.other_card, finding.other_range);
+	case Kind::adjacent:
+		return range + " can merge with " + name(finding.other_card, finding.other_range);
+	case Kind::too_long:
+	default:
+		return range + " leaves no room for the check digit";
+	}
+}
+
+/**
+ * @brief Returns the number of covered numbers (see Card::Span) of a single prefix of digits digits.
+ */
+static unsigned long long scale(int digits)
+{
+	unsigned long long value{ 1 };
+	for (int i{ digits }; i < Card::span_digits; i++)
+	{
+		value *= 10;
+	}
+	return value;
+}
+
+/**
+ * @brief Shrinks the ranges of every card without changing the numbers it can generate.
+ *
+ * The spans of a card are swept in order: spans inside an earlier one (duplicates and
+ * shadowed ranges) are dropped, spans of the same digits that overlap or touch are merged,
+ * and where spans of different digits overlap, the part they share is cut from the span with
+ * more digits (5 and 45-55 become 5 and 45-49). The remaining ranges are sorted and joined
+ * where they are contiguous. The sampling tables of the card get smaller and numbers covered
+ * by two ranges are no longer drawn twice as often. Overlaps between issuers are left for the
+ * user to resolve.
+ *
+ * @param cards The catalog, cards whose ranges change are replaced.
+ * @return The number of ranges removed.
+ */
+size_t Linter::merge(std::vector<Card>& cards)
+{
+	size_t removed{};
+	for (Card& card : cards)
+	{
+		const auto& ranges{ card.get_ranges() };
+		std::vector<LintSpan> spans{};
+		for (size_t j{}; j < ranges.size(); j++)
+		{
+			LintSpan proto{};
+			proto.range = j;
+			split_range(ranges[j], proto, spans);
+		}
+		std::sort(spans.begin(), spans.end(), span_less);
+
+		// the kept spans are disjoint and in order, so only the last one can reach the next span
+		std::vector<Card::Span> kept{};
+		for (const LintSpan& sorted : spans)
+		{
+			Card::Span span{ sorted };
+			if (kept.empty() == false && span.hi <= kept.back().hi)
+			{
+				continue;
+			}
+			if (kept.empty() == false && span.digits == kept.back().digits && span.first <= static_cast<long long>(kept.back().last) + 1)
+			{
+				kept.back().last = span.last;
+				kept.back().hi = span.hi;
+				continue;
+			}
+			if (kept.empty() == false && span.lo <= kept.back().hi)
+			{
+				// prefixes of different digits overlap, the span with more digits gives up the shared part
+				Card::Span& last{ kept.back() };
+				if (last.digits > span.digits)
+				{
+					last.last = static_cast<int>(span.lo / scale(last.digits)) - 1;
+					last.hi = span.lo - 1;
+					if (last.last < last.first)
+					{
+						kept.pop_back();
+					}
+				}
+				else
+				{
+					span.first = static_cast<int>((last.hi + 1) / scale(span.digits));
+					span.lo = last.hi + 1;
+				}
+			}
+			kept.push_back(span);
+		}
+
+		std::vector<std::pair<int, int>> merged{};
+		for (const Card::Span& span : kept)
+		{
+			merged.emplace_back(span.first, span.last);
+		}
+		std::sort(merged.begin(), merged.end());
+		std::vector<std::pair<int, int>> joined{};
+		for (const auto& range : merged)
+		{
+			if (joined.empty() == false && range.first <= static_cast<long long>(joined.back().second) + 1)
+			{
+				joined.back().second = std::max(joined.back().second, range.second);
+			}
+			else
+			{
+				joined.push_back(range);
+			}
+		}
+
+		if (joined != ranges)
+		{
+			removed += ranges.size() > joined.size() ? ranges.size() - joined.size() : 0;
+			card = Card{ card.get_issuer(), card.get_len(), std::move(joined) };
+		}
+	}
+	return removed;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Card.h"
+
+/**
+ * @class Linter
+ * @brief Finds ranges of a catalog that overlap, repeat, shadow each other or can't generate.
+ *
+ * A prefix stands for every card number that starts with it, so "4" covers "4571". Every
+ * range is mapped to the interval of card numbers it covers (ranges whose ends have a
+ * different number of digits are split first), the intervals of all cards are sorted once and
+ * a single sweep compares each one with the furthest-reaching interval of its own issuer and
+ * with every interval of another issuer that overlaps it (see lint). The whole pass is
+ * O(n log n + k) in the number of ranges n and of overlapping pairs k.
+ */
+class Linter
+{
+public:
+	enum class Kind
+	{
+		overlap,	// Intersects a range of another issuer, or partially one of its own.
+		duplicate,	// Covers exactly what another range of the issuer covers.
+		shadowed,	// Lies inside another range of the issuer, which makes it more likely.
+		adjacent,	// Touches a range of the issuer with the same digits, they can merge.
+		too_long	// Has as many digits as the card, there is no room for the check digit.
+	};
+
+	// A range of the catalog and the range it conflicts with.
+	struct Finding
+	{
+		Kind kind{};
+		size_t card{};					// Index of the card in the catalog.
+		size_t range{};					// Index of the range in the card.
+		size_t other_card{ npos };		// The conflicting range, npos for too_long.
+		size_t other_range{ npos };
+	};
+
+	static constexpr size_t npos{ static_cast<size_t>(-1) };
+
+	// Analyzes the ranges of cards, the findings are ordered by card and range.
+	static std::vector<Finding> lint(const std::vector<Card>& cards);
+
+	// Describes a finding of lint(cards) in one line.
+	static std::string describe(const std::vector<Card>& cards, const Finding& finding);
+
+	// Drops duplicate and shadowed ranges, merges the overlapping and adjacent ones and cuts the
+	// overlaps between prefixes of different digits of every card, returns the number of ranges removed.
+	static size_t merge(std::vector<Card>& cards);
+
+	Linter() = delete;
+};
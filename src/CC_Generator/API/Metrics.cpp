@@ -0,0 +1,226 @@
+#include "Metrics.h"
+#include <cstdio>
+
+#if defined(_WIN64) || defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+/**
+ * @brief Resets the totals and starts the clock, the first sample is pushed by the first record().
+ */
+void Metrics::start()
+{
+	m_start = std::chrono::steady_clock::now();
+	m_stage_start = m_start;
+	m_stage = Stage::starting;
+	m_cpu_start = thread_cpu_seconds();
+	m_last = Sample{};
+	m_interval_rates.clear();
+	m_last_sample = -sample_interval;
+	m_generate = 0.0;
+	m_write = 0.0;
+	m_wait = 0.0;
+}
+
+/**
+ * @brief Adds the time since the previous call to the stage that ends and starts the next one.
+ *
+ * Waiting for the pacer and being paused both count as waiting.
+ *
+ * @param stage The stage the export enters, may be the current one.
+ */
+void Metrics::enter(Stage stage)
+{
+	std::chrono::steady_clock::time_point now{ std::chrono::steady_clock::now() };
+	double seconds{ std::chrono::duration<double>(now - m_stage_start).count() };
+	switch (m_stage.load(std::memory_order_relaxed))
+	{
+	case Stage::generating:
+		m_generate += seconds;
+		break;
+	case Stage::writing:
+		m_write += seconds;
+		break;
+	case Stage::waiting:
+	case Stage::paused:
+		m_wait += seconds;
+		break;
+	default:
+		break;
+	}
+	m_stage_start = now;
+	m_stage.store(stage, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the name of a stage.
+ */
+const char* Metrics::stage_name(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::generating:
+		return "generating";
+	case Stage::writing:
+		return "writing";
+	case Stage::waiting:
+		return "waiting for the rate limit";
+	case Stage::paused:
+		return "paused";
+	case Stage::finished:
+		return "finished";
+	default:
+		return "starting";
+	}
+}
+
+/**
+ * @brief Seconds since start().
+ */
+double Metrics::elapsed() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+/**
+ * @brief Pushes the totals into the ring, at most once every sample_interval.
+ *
+ * The time spent in the current stage so far is added first, so the sample is up to date. The
+ * slot is filled before the head moves past it (release), so the display never sees a sample
+ * that is still being written. A full ring drops the sample, but the export keeps the totals
+ * and the rates of the interval either way.
+ *
+ * @param cards Cards written so far.
+ * @param bytes Bytes written so far.
+ * @param last Push even if the interval hasn't passed, for the final totals of the export.
+ */
+void Metrics::record(unsigned long long cards, unsigned long long bytes, bool last)
+{
+	double now{ elapsed() };
+	if (last == false && now - m_last_sample < sample_interval)
+	{
+		return;
+	}
+	m_last_sample = now;
+	enter(stage());
+
+	Sample sample{ now, cards, bytes, m_generate, m_write, m_wait, resident_bytes() };
+	double interval{ now - m_last.seconds };
+	if (interval >= sample_interval / 2)
+	{
+		// a last sample right after the previous one would only add noise to the rates
+		m_interval_rates.emplace_back(static_cast<float>((cards - m_last.cards) / interval), static_cast<float>((bytes - m_last.bytes) / interval));
+	}
+	m_last = sample;
+
+	size_t head{ m_head.load(std::memory_order_relaxed) };
+	if (head - m_tail.load(std::memory_order_acquire) >= capacity)
+	{
+		m_dropped++;
+		return;
+	}
+	m_ring[head % capacity] = sample;
+	m_head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Pops the oldest sample pushed by the export.
+ *
+ * @param sample Receives the sample.
+ * @return True if there was a sample, false otherwise.
+ */
+bool Metrics::pop(Sample& sample)
+{
+	size_t tail{ m_tail.load(std::memory_order_relaxed) };
+	if (tail == m_head.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	sample = m_ring[tail % capacity];
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * @brief Reads the resident set size of the process.
+ *
+ * From GetProcessMemoryInfo on Windows and /proc/self/statm elsewhere.
+ */
+unsigned long long Metrics::resident_bytes()
+{
+#if defined(_WIN64) || defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	unsigned long long pages{}, resident{};
+	std::FILE* statm{ std::fopen("/proc/self/statm", "r") };
+	if (statm == nullptr)
+	{
+		return 0;
+	}
+	int fields{ std::fscanf(statm, "%llu %llu", &pages, &resident) };
+	std::fclose(statm);
+	return fields == 2 ? resident * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
+
+/**
+ * @brief Reads the peak resident set size of the process.
+ *
+ * From GetProcessMemoryInfo on Windows and getrusage elsewhere (kilobytes on Linux, bytes on macOS).
+ */
+unsigned long long Metrics::peak_resident_bytes()
+{
+#if defined(_WIN64) || defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#if defined(__APPLE__)
+	return static_cast<unsigned long long>(usage.ru_maxrss);
+#else
+	return static_cast<unsigned long long>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * @brief Reads the CPU time of the calling thread, user and kernel.
+ */
+double Metrics::thread_cpu_seconds()
+{
+#if defined(_WIN64) || defined(_WIN32)
+	FILETIME creation{}, exit{}, kernel{}, user{};
+	if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user) == FALSE)
+	{
+		return 0.0;
+	}
+	auto ticks = [](const FILETIME& time) { return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+	return (ticks(kernel) + ticks(user)) / 1e7;
+#else
+	timespec time{};
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+	{
+		return 0.0;
+	}
+	return time.tv_sec + time.tv_nsec / 1e9;
+#endif
+}
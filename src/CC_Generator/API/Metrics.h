@@ -0,0 +1,139 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @class Metrics
+ * @brief Throughput and resource samples of a running export, handed to a display without locks.
+ *
+ * The export thread reports every change of its stage: generating a batch, writing it to the
+ * sink and waiting (paused, or held back by a pacer), and the time between two changes is added
+ * to the stage that ended. Every sample_interval it pushes a Sample with the running totals into
+ * a single-producer single-consumer ring, and the display pops the samples from its own thread.
+ * Neither side ever blocks: a sample that finds the ring full is dropped, and since the samples
+ * carry totals the next one makes up for it.
+ *
+ * The current stage and the cards written of every catalog card can be read at any time. Only
+ * the export thread writes them, so it counts with plain loads and stores, without a locked
+ * instruction per card.
+ *
+ * The shares of the stages tell what bounds a run: mostly generating is CPU bound, mostly
+ * writing is bound by the disk (or the database), mostly waiting is the pacer or a pause.
+ */
+class Metrics
+{
+public:
+	// What the export thread is doing.
+	enum class Stage : uint8_t
+	{
+		starting,
+		generating,
+		writing,
+		waiting,		// For the pacer.
+		paused,
+		finished
+	};
+
+	// The totals of an export at one point in time.
+	struct Sample
+	{
+		double seconds{};						// Since the export started.
+		unsigned long long cards{};				// Cards written.
+		unsigned long long bytes{};				// Bytes written.
+		double generate_seconds{};				// Time spent generating cards.
+		double write_seconds{};					// Time spent in the sink.
+		double wait_seconds{};					// Time paused or waiting for the pacer.
+		unsigned long long resident_bytes{};	// Resident memory of the process.
+	};
+
+	// Counts the cards written of each of the first cards of the catalog, 0 counts none.
+	explicit Metrics(size_t cards = 0) : m_card_counts(cards) {}
+
+	// The export side, called from the export thread only.
+
+	// Starts the clock of the export.
+	void start();
+
+	// Ends the current stage and starts another.
+	void enter(Stage stage);
+
+	// Counts written cards, given as indexes in the catalog.
+	void count_cards(const int* cards, size_t count)
+	{
+		for (size_t i{}; i < count; i++)
+		{
+			if (static_cast<size_t>(cards[i]) < m_card_counts.size())
+			{
+				std::atomic<unsigned long long>& counter{ m_card_counts[cards[i]] };
+				counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Pushes a sample with the totals if sample_interval passed since the last one, or if last is true.
+	void record(unsigned long long cards, unsigned long long bytes, bool last);
+
+	// The cards/s and bytes/s of every interval between two samples, in order, for the report of the export.
+	const std::vector<std::pair<float, float>>& interval_rates() const { return m_interval_rates; }
+
+	// Seconds of CPU the export thread used since start().
+	double cpu_seconds() const { return thread_cpu_seconds() - m_cpu_start; }
+
+	// The totals of the last sample.
+	const Sample& last_sample() const { return m_last; }
+
+	// The display side, called from one other thread.
+
+	// Pops the oldest sample, returns false if there is none.
+	bool pop(Sample& sample);
+
+	// Samples dropped because the ring was full.
+	unsigned long long dropped() const { return m_dropped; }
+
+	// The current stage of the export.
+	Stage stage() const { return m_stage.load(std::memory_order_relaxed); }
+
+	// Cards written of catalog card i so far, 0 for a card that isn't counted.
+	unsigned long long card_count(size_t i) const { return i < m_card_counts.size() ? m_card_counts[i].load(std::memory_order_relaxed) : 0; }
+
+	// A short lower case name of a stage, e.g. for a status line.
+	static const char* stage_name(Stage stage);
+
+	// The resident memory of this process, 0 where it can't be read.
+	static unsigned long long resident_bytes();
+
+	// The largest resident memory of this process so far, 0 where it can't be read.
+	static unsigned long long peak_resident_bytes();
+
+	// Seconds of CPU used by the calling thread.
+	static double thread_cpu_seconds();
+
+	// Seconds since start(), the clock the samples use.
+	double elapsed() const;
+
+	static constexpr size_t capacity{ 1024 };			// Samples the ring holds.
+	static constexpr double sample_interval{ 0.1 };		// Seconds between two samples.
+
+private:
+	std::array<Sample, capacity> m_ring{};
+	std::atomic<size_t> m_head{};			// Samples pushed, written by the export.
+	std::atomic<size_t> m_tail{};			// Samples popped, written by the display.
+	std::atomic<unsigned long long> m_dropped{};
+	std::atomic<Stage> m_stage{ Stage::starting };
+	std::vector<std::atomic<unsigned long long>> m_card_counts{};
+
+	std::chrono::steady_clock::time_point m_start{};
+	std::chrono::steady_clock::time_point m_stage_start{};
+	double m_last_sample{};
+	double m_cpu_start{};
+	Sample m_last{};
+	std::vector<std::pair<float, float>> m_interval_rates{};
+	double m_generate{};
+	double m_write{};
+	double m_wait{};
+};
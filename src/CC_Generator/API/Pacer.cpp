@@ -0,0 +1,226 @@
+#include "Pacer.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <chrono>
+#include <thread>
+
+#if !defined(_WIN64) && !defined(_WIN32)
+#include <time.h>
+#include <cerrno>
+#endif
+
+/**
+ * @brief Returns the current time of the monotonic clock in seconds.
+ */
+double Pacer::now()
+{
+#if defined(_WIN64) || defined(_WIN32)
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+	timespec ts{};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+/**
+ * @brief Sleeps until the monotonic clock reaches deadline.
+ *
+ * On POSIX the deadline is absolute (TIMER_ABSTIME), so time spent before the call
+ * and interrupted sleeps don't accumulate as drift.
+ *
+ * @param deadline The wakeup time in seconds of the monotonic clock.
+ */
+void Pacer::sleep_until(double deadline)
+{
+#if defined(_WIN64) || defined(_WIN32)
+	std::this_thread::sleep_for(std::chrono::duration<double>(std::max(0.0, deadline - now())));
+#else
+	timespec ts{};
+	ts.tv_sec = static_cast<time_t>(deadline);
+	ts.tv_nsec = static_cast<long>((deadline - static_cast<double>(ts.tv_sec)) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+	{
+	}
+#endif
+}
+
+/**
+ * @brief Parses a ramp profile.
+ *
+ * The accepted formats are "linear:END:SECONDS", "step:INCREMENT:SECONDS" and
+ * "sine:AMPLITUDE:PERIOD". The start rate of the profile is left unchanged.
+ *
+ * @param str The profile to parse.
+ * @param profile Receives the shape and its parameters.
+ * @return True if str is a valid profile, false otherwise.
+ */
+bool Pacer::parse_ramp(const std::string& str, Profile& profile)
+{
+	std::istringstream iss(str);
+	std::string shape{};
+	char colon{};
+	double param{}, period{};
+
+	if (!std::getline(iss, shape, ':') || !(iss >> param >> colon >> period) || colon != ':' || period <= 0 || param < 0)
+	{
+		return false;
+	}
+
+	if (shape == "linear")
+	{
+		profile.shape = Shape::linear;
+	}
+	else if (shape == "step")
+	{
+		profile.shape = Shape::step;
+	}
+	else if (shape == "sine")
+	{
+		profile.shape = Shape::sine;
+	}
+	else
+	{
+		return false;
+	}
+	profile.param = param;
+	profile.period = period;
+	return true;
+}
+
+/**
+ * @brief Returns the target rate of the profile.
+ *
+ * @param seconds Time since the first acquire.
+ * @return The target rate in cards per second, never negative.
+ */
+double Pacer::rate_at(double seconds) const
+{
+	constexpr double pi{ 3.14159265358979323846 };
+	double rate{ m_profile.rate };
+
+	switch (m_profile.shape)
+	{
+	case Shape::linear:
+		rate += (m_profile.param - m_profile.rate) * std::min(seconds / m_profile.period, 1.0);
+		break;
+	case Shape::step:
+		rate += m_profile.param * std::floor(seconds / m_profile.period);
+		break;
+	case Shape::sine:
+		rate += m_profile.param * std::sin(2 * pi * seconds / m_profile.period);
+		break;
+	default:
+		break;
+	}
+	return std::max(rate, 0.0);
+}
+
+/**
+ * @brief Returns the number of cards to write per paced slice.
+ *
+ * A slice covers about slice_seconds at the current rate, so slow rates release
+ * single cards and fast rates release whole batches.
+ *
+ * @param max_cards The largest slice the caller can write at once.
+ * @return The slice size in cards.
+ */
+unsigned long long Pacer::slice_cards(unsigned long long max_cards) const
+{
+	double rate{ rate_at(m_started ? now() - m_start : 0.0) };
+	double cards{ std::floor(rate * slice_seconds) };
+	if (cards < 1)
+	{
+		return 1;
+	}
+	return std::min(static_cast<unsigned long long>(cards), max_cards);
+}
+
+/**
+ * @brief Adds the tokens accumulated since the last refill.
+ *
+ * The bucket holds the pending request plus one slice worth of tokens, enough to make up
+ * for a late wakeup but not to let an export that fell behind burst to catch up.
+ *
+ * @param t The current time.
+ * @param cards The number of cards waiting for tokens.
+ */
+void Pacer::refill(double t, unsigned long long cards)
+{
+	double rate{ rate_at((t + m_last) / 2 - m_start) };
+	double capacity{ static_cast<double>(cards) + std::max(1.0, rate * slice_seconds) };
+	m_tokens = std::min(m_tokens + rate * (t - m_last), capacity);
+	m_last = t;
+}
+
+/**
+ * @brief Waits until enough tokens for cards are available and takes them.
+ *
+ * @param cards The number of cards about to be written.
+ * @param running Cleared by the caller to abort the wait.
+ * @param paused While set, no tokens accumulate.
+ * @return True if the tokens were taken, false if running was cleared.
+ */
+bool Pacer::acquire(unsigned long long cards, const std::atomic<bool>& running, const std::atomic<bool>& paused)
+{
+	double t{ now() };
+	if (m_started == false)
+	{
+		m_started = true;
+		m_start = m_last = t;
+		m_tokens = static_cast<double>(cards);
+	}
+	refill(t, cards);
+
+	while (m_tokens < static_cast<double>(cards))
+	{
+		if (running == false)
+		{
+			return false;
+		}
+		if (paused)
+		{
+			sleep_until(t + max_sleep);
+			t = now();
+			m_last = t;
+			continue;
+		}
+
+		double rate{ rate_at(t - m_start) };
+		double deadline{ rate > 0 ? t + (static_cast<double>(cards) - m_tokens) / rate : t + max_sleep };
+		bool full_wait{ deadline - t <= max_sleep };
+		sleep_until(full_wait ? deadline : t + max_sleep);
+		t = now();
+		refill(t, cards);
+
+		if (full_wait && m_tokens >= static_cast<double>(cards))
+		{
+			double jitter{ std::max(0.0, t - deadline) };
+			m_jitter_sum += jitter;
+			m_jitter_max = std::max(m_jitter_max, jitter);
+			m_waits++;
+		}
+	}
+
+	m_tokens -= static_cast<double>(cards);
+	m_cards += cards;
+	return true;
+}
+
+/**
+ * @brief Returns the seconds since the first acquire.
+ */
+double Pacer::elapsed() const
+{
+	return m_started ? now() - m_start : 0.0;
+}
+
+/**
+ * @brief Returns the average rate in cards per second since the first acquire.
+ */
+double Pacer::achieved_rate() const
+{
+	double seconds{ elapsed() };
+	return seconds > 0 ? static_cast<double>(m_cards) / seconds : 0.0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <string>
+
+/**
+ * @class Pacer
+ * @brief Token bucket that limits an export to a target rate of cards per second.
+ *
+ * Tokens accumulate at the rate of the configured profile and an export takes as many
+ * tokens as cards it's about to write, sleeping on an absolute monotonic deadline
+ * (clock_nanosleep on POSIX) until enough are available. Pacing is done per slice of
+ * cards rather than per card, so the overhead stays flat at high rates.
+ *
+ * The pacer also measures how late each wakeup was against its deadline (jitter) and
+ * the rate that was actually achieved.
+ */
+class Pacer
+{
+public:
+	// Shape of the target rate over time.
+	enum class Shape
+	{
+		constant,	// rate
+		linear,		// from rate to param over period seconds, then param
+		step,		// rate, increased by param every period seconds
+		sine		// rate + param * sin(2*pi*t / period)
+	};
+
+	// The target rate over time.
+	struct Profile
+	{
+		Shape shape{ Shape::constant };
+		double rate{};		// Cards per second at the start.
+		double param{};		// End rate, step increment or amplitude, depending on shape.
+		double period{};	// Ramp duration, step duration or sine period in seconds.
+	};
+
+	explicit Pacer(const Profile& profile) : m_profile{ profile } {}
+
+	// Parses "linear:END:SECONDS", "step:INCREMENT:SECONDS" or "sine:AMPLITUDE:PERIOD" into profile.
+	static bool parse_ramp(const std::string& str, Profile& profile);
+
+	// Returns the target rate at the given number of seconds after the first acquire.
+	double rate_at(double seconds) const;
+
+	// Returns how many cards to write per paced slice at the current rate, at least 1 and at most max_cards.
+	unsigned long long slice_cards(unsigned long long max_cards) const;
+
+	// Waits until cards tokens are available and takes them, returns false if running was cleared.
+	bool acquire(unsigned long long cards, const std::atomic<bool>& running, const std::atomic<bool>& paused);
+
+	// Statistics
+	unsigned long long cards() const { return m_cards; }
+	double elapsed() const;
+	double achieved_rate() const;
+	double mean_jitter_us() const { return m_waits == 0 ? 0.0 : m_jitter_sum / m_waits * 1e6; }
+	double max_jitter_us() const { return m_jitter_max * 1e6; }
+
+private:
+	static double now();
+	static void sleep_until(double deadline);
+	void refill(double t, unsigned long long cards);
+
+	static constexpr double slice_seconds{ 0.01 };	// Target duration of a paced slice.
+	static constexpr double max_sleep{ 0.1 };		// Longest sleep before running is checked again.
+
+	Profile m_profile{};
+	bool m_started{ false };
+	double m_start{};
+	double m_last{};
+	double m_tokens{};
+	unsigned long long m_cards{};
+	unsigned long long m_waits{};
+	double m_jitter_sum{};
+	double m_jitter_max{};
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * @file Probes.h
+ * @brief USDT probes of File::export_cards, for bpftrace, perf and SystemTap.
+ *
+ * The probes are compiled in when <sys/sdt.h> is found (systemtap-sdt-dev on Debian and
+ * Ubuntu, systemtap-sdt-devel on Fedora). Each one is a single nop in the exporter until a
+ * tracer attaches to it, elsewhere they expand to nothing. List them with
+ * "bpftrace -l 'usdt:./CC_Generator_Console:*'", export_latency.bt is an example.
+ *
+ * Provider "ccgen", the arguments in order:
+ *
+ * | Probe            | Arguments                                               | Fired                                            |
+ * |------------------|---------------------------------------------------------|--------------------------------------------------|
+ * | export__start    | seed, cards requested, first card (resume)              | Before the first batch                           |
+ * | export__end      | cards, bytes (the whole output), complete (0 or 1)      | After the sink is finished                       |
+ * | batch__start     | batch index, first card of the batch                    | Before a batch is generated                      |
+ * | batch__generated | batch index, cards, bytes                               | The batch is in the buffer, ready to be written  |
+ * | write__start     | batch index, cards, bytes                               | Before a write to the sink                       |
+ * | write__done      | batch index, bytes, ok (0 or 1)                         | After the write returned                         |
+ * | pause            | cards written                                           | The export noticed the pause                     |
+ * | resume           | cards written                                           | The export continues after a pause               |
+ *
+ * A paced export writes a batch in several slices, with a write__start and write__done pair
+ * per slice. Cards and bytes written before a resumed export are included in the totals.
+ */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CCGEN_PROBE1(name, a) DTRACE_PROBE1(ccgen, name, a)
+#define CCGEN_PROBE2(name, a, b) DTRACE_PROBE2(ccgen, name, a, b)
+#define CCGEN_PROBE3(name, a, b, c) DTRACE_PROBE3(ccgen, name, a, b, c)
+#endif
+#endif
+
+#if !defined(CCGEN_PROBE1)
+#define CCGEN_PROBE1(name, a) ((void)0)
+#define CCGEN_PROBE2(name, a, b) ((void)0)
+#define CCGEN_PROBE3(name, a, b, c) ((void)0)
+#endif
@@ -0,0 +1,485 @@
+#include "SearchIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <numeric>
+#include <unordered_map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static constexpr unsigned long long pow10[]{ 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL };
+
+/**
+ * @brief Lower cases the ASCII letters of text.
+ */
+static std::string to_lower(std::string_view text)
+{
+	std::string lower(text);
+	for (char& c : lower)
+	{
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	return lower;
+}
+
+/**
+ * @brief Packs an n-gram of one to three characters and its size into a key.
+ */
+static uint32_t gram_key(const char* gram, size_t size)
+{
+	uint32_t key{ static_cast<uint32_t>(size) << 24 };
+	for (size_t i{}; i < size; i++)
+	{
+		key |= static_cast<uint32_t>(static_cast<unsigned char>(gram[i])) << (8 * (2 - i));
+	}
+	return key;
+}
+
+/**
+ * @brief Returns the position of the lowest set bit of a non-zero word.
+ */
+static int lowest_bit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index{};
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+/**
+ * @brief Parses a string of up to span_digits digits.
+ *
+ * @return True if text is a number that fits, false otherwise.
+ */
+static bool parse_number(std::string_view text, unsigned long long& value)
+{
+	if (text.empty() || text.size() > Card::span_digits)
+	{
+		return false;
+	}
+	value = 0;
+	for (char c : text)
+	{
+		if (std::isdigit(static_cast<unsigned char>(c)) == 0)
+		{
+			return false;
+		}
+		value = value * 10 + static_cast<unsigned long long>(c - '0');
+	}
+	return true;
+}
+
+/**
+ * @brief Splits the text into terms and finds the numbers covered by the terms of digits.
+ *
+ * A term of digits covers the numbers that start with it, cut to span_digits digits like the
+ * spans of the ranges, so a longer number is cut to its first span_digits digits. "lo-hi"
+ * covers the spans of that prefix range, and "lo-" (a range still being typed) covers lo.
+ *
+ * @param text The search as the user typed it.
+ */
+SearchIndex::Query::Query(std::string_view text)
+{
+	size_t pos{};
+	while (pos < text.size())
+	{
+		size_t end{ text.find_first_of(" ,\t", pos) };
+		end = end == std::string_view::npos ? text.size() : end;
+		std::string_view word{ text.substr(pos, end - pos) };
+		pos = end + 1;
+		if (word.empty())
+		{
+			continue;
+		}
+
+		Term term{};
+		term.text = to_lower(word);
+
+		size_t dash{ word.find('-') };
+		std::string_view first{ word.substr(0, dash) };
+		std::string_view last{ dash == std::string_view::npos ? std::string_view{} : word.substr(dash + 1) };
+		unsigned long long lo{}, hi{};
+		if (last.empty() && first.find_first_not_of("0123456789") == std::string_view::npos && first.empty() == false)
+		{
+			std::string_view digits{ first.substr(0, Card::span_digits) };
+			parse_number(digits, lo);
+			unsigned long long scale{ pow10[Card::span_digits - digits.size()] };
+			term.spans.emplace_back(lo * scale, (lo + 1) * scale - 1);
+		}
+		else if (parse_number(first, lo) && parse_number(last, hi) && lo <= hi && hi <= INT_MAX)
+		{
+			std::vector<Card::Span> spans{};
+			Card::split_range({ static_cast<int>(lo), static_cast<int>(hi) }, spans);
+			for (const auto& span : spans)
+			{
+				term.spans.emplace_back(span.lo, span.hi);
+			}
+		}
+		m_terms.push_back(std::move(term));
+	}
+}
+
+/**
+ * @brief Checks every term against the issuer, the length and the ranges of a card.
+ *
+ * This is the test SearchIndex::search runs through the index, one card at a time.
+ */
+bool SearchIndex::Query::matches(const Card& card) const
+{
+	std::string issuer{ to_lower(card.get_issuer()) };
+	std::string length{ std::to_string(card.get_len()) };
+	std::vector<Card::Span> spans{};
+	for (const Term& term : m_terms)
+	{
+		if (issuer.find(term.text) != std::string::npos || length.find(term.text) != std::string::npos)
+		{
+			continue;
+		}
+		if (term.spans.empty())
+		{
+			return false;
+		}
+		if (spans.empty())
+		{
+			for (const auto& range : card.get_ranges())
+			{
+				Card::split_range(range, spans);
+			}
+		}
+		bool covered{ std::any_of(spans.begin(), spans.end(), [&term](const Card::Span& span) {
+			return std::any_of(term.spans.begin(), term.spans.end(), [&span](const auto& wanted) { return span.lo <= wanted.second && span.hi >= wanted.first; });
+			}) };
+		if (covered == false)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Indexes the issuers, lengths and ranges of cards.
+ *
+ * Building takes O(n log n) in the number of ranges, a million ranges take a fraction of a
+ * second.
+ *
+ * @param cards The cards, the results of search() are indexes into it.
+ */
+void SearchIndex::build(const std::vector<Card>& cards)
+{
+	*this = SearchIndex{};
+	m_issuer_of.reserve(cards.size());
+	m_length_of.reserve(cards.size());
+
+	std::unordered_map<std::string_view, uint32_t> ids{};
+	for (const Card& card : cards)
+	{
+		auto it = ids.find(card.get_issuer());
+		if (it == ids.end())
+		{
+			it = ids.emplace(card.get_issuer(), static_cast<uint32_t>(m_names.size())).first;
+			m_names.push_back(to_lower(card.get_issuer()));
+		}
+		m_issuer_of.push_back(it->second);
+		m_length_of.push_back(static_cast<uint8_t>(std::clamp(card.get_len(), 0, 255)));
+	}
+
+	// the cards of every issuer and of every length, in catalog order
+	std::vector<uint32_t> counts(m_names.size() + 1, 0);
+	for (uint32_t id : m_issuer_of)
+	{
+		counts[id + 1]++;
+	}
+	std::partial_sum(counts.begin(), counts.end(), counts.begin());
+	m_issuer_offsets = counts;
+	m_issuer_cards.resize(cards.size());
+	for (size_t i{}; i < cards.size(); i++)
+	{
+		m_issuer_cards[counts[m_issuer_of[i]]++] = static_cast<int>(i);
+		int len{ cards[i].get_len() };
+		if (len < 0 || len > 255)
+		{
+			continue;
+		}
+		if (static_cast<size_t>(len) >= m_length_cards.size())
+		{
+			m_length_cards.resize(len + 1);
+		}
+		m_length_cards[len].push_back(static_cast<int>(i));
+	}
+
+	// every n-gram of one to three characters of every name
+	std::vector<std::pair<uint32_t, uint32_t>> grams{};
+	for (uint32_t id{}; id < m_names.size(); id++)
+	{
+		const std::string& name{ m_names[id] };
+		for (size_t size{ 1 }; size <= 3; size++)
+		{
+			for (size_t i{}; i + size <= name.size(); i++)
+			{
+				grams.emplace_back(gram_key(name.data() + i, size), id);
+			}
+		}
+	}
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+	m_gram_names.reserve(grams.size());
+	for (const auto& gram : grams)
+	{
+		if (m_gram_keys.empty() || m_gram_keys.back() != gram.first)
+		{
+			m_gram_keys.push_back(gram.first);
+			m_gram_offsets.push_back(static_cast<uint32_t>(m_gram_names.size()));
+		}
+		m_gram_names.push_back(gram.second);
+	}
+	m_gram_offsets.push_back(static_cast<uint32_t>(m_gram_names.size()));
+
+	// the spans of every range, by start
+	struct IndexSpan
+	{
+		unsigned long long lo{};
+		unsigned long long hi{};
+		int card{};
+	};
+	std::vector<IndexSpan> index_spans{};
+	std::vector<Card::Span> spans{};
+	for (size_t i{}; i < cards.size(); i++)
+	{
+		spans.clear();
+		for (const auto& range : cards[i].get_ranges())
+		{
+			Card::split_range(range, spans);
+		}
+		for (const auto& span : spans)
+		{
+			index_spans.push_back(IndexSpan{ span.lo, span.hi, static_cast<int>(i) });
+		}
+	}
+	std::sort(index_spans.begin(), index_spans.end(), [](const IndexSpan& a, const IndexSpan& b) { return a.lo < b.lo; });
+	m_span_lo.reserve(index_spans.size());
+	m_span_hi.reserve(index_spans.size());
+	m_span_card.reserve(index_spans.size());
+	for (size_t i{}; i < index_spans.size(); i++)
+	{
+		if (i % block_size == 0)
+		{
+			m_block_hi.push_back(0);
+		}
+		m_span_lo.push_back(index_spans[i].lo);
+		m_span_hi.push_back(index_spans[i].hi);
+		m_span_card.push_back(index_spans[i].card);
+		m_block_hi.back() = std::max(m_block_hi.back(), index_spans[i].hi);
+	}
+}
+
+/**
+ * @brief Finds the issuers, the lengths and the ranges a term matches.
+ */
+void SearchIndex::match_term(const Query::Term& term, TermMatch& match) const
+{
+	match.issuers.assign(m_names.size(), 0);
+	match.lengths.fill(0);
+	match.span_hits.clear();
+	match.span_cards.clear();
+	match.estimate = 0;
+
+	// the names listed under the term itself, or under its rarest trigram and containing the term
+	const std::string& text{ term.text };
+	auto posting = [this](const char* gram, size_t size, uint32_t& first, uint32_t& last) {
+		uint32_t key{ gram_key(gram, size) };
+		auto it = std::lower_bound(m_gram_keys.begin(), m_gram_keys.end(), key);
+		if (it == m_gram_keys.end() || *it != key)
+		{
+			first = last = 0;
+			return;
+		}
+		size_t i{ static_cast<size_t>(it - m_gram_keys.begin()) };
+		first = m_gram_offsets[i];
+		last = m_gram_offsets[i + 1];
+	};
+	uint32_t first{}, last{};
+	posting(text.data(), std::min<size_t>(text.size(), 3), first, last);
+	for (size_t i{ 1 }; i + 3 <= text.size() && first < last; i++)
+	{
+		uint32_t gram_first{}, gram_last{};
+		posting(text.data() + i, 3, gram_first, gram_last);
+		if (gram_last - gram_first < last - first)
+		{
+			first = gram_first;
+			last = gram_last;
+		}
+	}
+	for (uint32_t i{ first }; i < last; i++)
+	{
+		uint32_t id{ m_gram_names[i] };
+		if (text.size() <= 3 || m_names[id].find(text) != std::string::npos)
+		{
+			match.issuers[id] = 1;
+			match.estimate += m_issuer_offsets[id + 1] - m_issuer_offsets[id];
+		}
+	}
+
+	for (size_t len{}; len < m_length_cards.size(); len++)
+	{
+		if (m_length_cards[len].empty() == false && std::to_string(len).find(text) != std::string::npos)
+		{
+			match.lengths[len] = 1;
+			match.estimate += m_length_cards[len].size();
+		}
+	}
+
+	// the spans that start before the end of the term, in the blocks that end after its start
+	if (term.spans.empty() == false)
+	{
+		match.span_hits.assign(size(), 0);
+	}
+	for (const auto& wanted : term.spans)
+	{
+		size_t end{ static_cast<size_t>(std::upper_bound(m_span_lo.begin(), m_span_lo.end(), wanted.second) - m_span_lo.begin()) };
+		for (size_t block{}; block * block_size < end; block++)
+		{
+			if (m_block_hi[block] < wanted.first)
+			{
+				continue;
+			}
+			for (size_t i{ block * block_size }; i < std::min(end, (block + 1) * block_size); i++)
+			{
+				int card{ m_span_card[i] };
+				if (m_span_hi[i] >= wanted.first && match.span_hits[card] == 0)
+				{
+					match.span_hits[card] = 1;
+					match.span_cards.push_back(card);
+				}
+			}
+		}
+	}
+	match.estimate += match.span_cards.size();
+}
+
+/**
+ * @brief Finds the cards that match every term of a query.
+ *
+ * The term that lists the fewest cards gives the candidates, which are checked against the
+ * other terms. The candidates are put in order by setting their bits in a bitset and reading
+ * the set bits back, which is cheaper than sorting them. When the term lists more than a
+ * quarter of the catalog every card is checked with table lookups instead.
+ *
+ * @param query The search.
+ * @param results Replaced by the indexes of the matching cards, ascending.
+ */
+void SearchIndex::search(const Query& query, std::vector<int>& results) const
+{
+	results.clear();
+	if (query.empty())
+	{
+		results.resize(size());
+		std::iota(results.begin(), results.end(), 0);
+		return;
+	}
+
+	std::vector<TermMatch> matches(query.m_terms.size());
+	size_t driver{};
+	for (size_t i{}; i < matches.size(); i++)
+	{
+		match_term(query.m_terms[i], matches[i]);
+		if (matches[i].estimate < matches[driver].estimate)
+		{
+			driver = i;
+		}
+	}
+	if (matches[driver].estimate == 0)
+	{
+		return;
+	}
+
+	auto matches_all = [this, &matches](int card) {
+		uint8_t matched{ 1 };
+		for (const TermMatch& term : matches)
+		{
+			matched &= card_matches(card, term);
+		}
+		return matched != 0;
+	};
+
+	const TermMatch& match{ matches[driver] };
+	if (match.estimate * 4 > size())
+	{
+		// every card is written and the count only advances on a match, the scan runs without branches
+		const uint32_t* issuer_of{ m_issuer_of.data() };
+		const uint8_t* length_of{ m_length_of.data() };
+		const uint8_t* issuers{ match.issuers.data() };
+		const uint8_t* lengths{ match.lengths.data() };
+		const uint8_t* span_hits{ match.span_hits.empty() ? nullptr : match.span_hits.data() };
+		results.resize(size());
+		int* out{ results.data() };
+		size_t found{};
+		for (size_t card{}; card < size(); card++)
+		{
+			out[found] = static_cast<int>(card);
+			found += issuers[issuer_of[card]] | lengths[length_of[card]] | (span_hits != nullptr ? span_hits[card] : 0);
+		}
+		results.resize(found);
+		if (matches.size() > 1)
+		{
+			results.erase(std::remove_if(results.begin(), results.end(), [&matches_all](int card) { return matches_all(card) == false; }), results.end());
+		}
+		return;
+	}
+
+	std::vector<uint64_t> candidates(size() / 64 + 1, 0);
+	auto add = [&candidates](int card) { candidates[card / 64] |= 1ULL << (card % 64); };
+	std::for_each(match.span_cards.begin(), match.span_cards.end(), add);
+	for (uint32_t id{}; id < match.issuers.size(); id++)
+	{
+		if (match.issuers[id] != 0)
+		{
+			std::for_each(m_issuer_cards.begin() + m_issuer_offsets[id], m_issuer_cards.begin() + m_issuer_offsets[id + 1], add);
+		}
+	}
+	for (size_t len{}; len < m_length_cards.size(); len++)
+	{
+		if (match.lengths[len] != 0)
+		{
+			std::for_each(m_length_cards[len].begin(), m_length_cards[len].end(), add);
+		}
+	}
+	for (size_t word{}; word < candidates.size(); word++)
+	{
+		for (uint64_t bits{ candidates[word] }; bits != 0; bits &= bits - 1)
+		{
+			int card{ static_cast<int>(word * 64 + lowest_bit(bits)) };
+			if (matches_all(card))
+			{
+				results.push_back(card);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Adds up the capacity of every array of the index.
+ */
+size_t SearchIndex::memory_bytes() const
+{
+	size_t bytes{ sizeof(SearchIndex) };
+	for (const std::string& name : m_names)
+	{
+		bytes += sizeof(std::string) + name.capacity();
+	}
+	for (const auto& cards : m_length_cards)
+	{
+		bytes += sizeof(cards) + cards.capacity() * sizeof(int);
+	}
+	bytes += m_length_of.capacity();
+	bytes += (m_issuer_of.capacity() + m_issuer_offsets.capacity() + m_gram_keys.capacity() + m_gram_offsets.capacity() + m_gram_names.capacity()) * sizeof(uint32_t);
+	bytes += (m_issuer_cards.capacity() + m_span_card.capacity()) * sizeof(int);
+	bytes += (m_span_lo.capacity() + m_span_hi.capacity() + m_block_hi.capacity()) * sizeof(unsigned long long);
+	return bytes;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Card.h"
+
+/**
+ * @class SearchIndex
+ * @brief Finds the cards of a catalog that match a search as it is typed.
+ *
+ * A search is a list of terms separated by spaces or commas, and a card matches if every term
+ * matches it. A term matches a card when it is part of the issuer (ignoring case) or of the
+ * length. A term of digits also matches the cards that have a range covering it: "4571" finds
+ * every card that can start with 4571, "45" every card with a range inside or around 45, and
+ * a whole card number the cards that could have issued it. "51-55" finds the ranges that
+ * overlap 51 to 55.
+ *
+ * The issuer names are indexed by their n-grams of one to three characters: a term of up to
+ * three characters is a single lookup, a longer one checks the names listed under its rarest
+ * trigram. The ranges are kept as spans (see Card::split_range) sorted by their start, with
+ * the largest end of every block of spans, so a lookup skips the blocks that end before
+ * the term. Each term is evaluated through the index once, the rarest one lists the
+ * candidates and the others are checked per candidate.
+ */
+class SearchIndex
+{
+public:
+	// A parsed search.
+	class Query
+	{
+	public:
+		explicit Query(std::string_view text);
+
+		// Whether the search has no terms, every card matches it.
+		bool empty() const { return m_terms.empty(); }
+
+		// Checks a card without an index, e.g. the rows of a catalog that is still loading.
+		bool matches(const Card& card) const;
+
+	private:
+		friend class SearchIndex;
+
+		struct Term
+		{
+			std::string text{};												// Lower case.
+			std::vector<std::pair<unsigned long long, unsigned long long>> spans{};	// Numbers covered by a term of digits.
+		};
+
+		std::vector<Term> m_terms{};
+	};
+
+	// Indexes cards, replacing the previous index.
+	void build(const std::vector<Card>& cards);
+
+	// Number of indexed cards.
+	size_t size() const { return m_issuer_of.size(); }
+
+	// Replaces results with the indexes of the cards that match query, ascending.
+	void search(const Query& query, std::vector<int>& results) const;
+
+	// Bytes used by the index.
+	size_t memory_bytes() const;
+
+private:
+	// What a term matches, found through the index.
+	struct TermMatch
+	{
+		std::vector<uint8_t> issuers{};			// 1 for the matching issuer ids.
+		std::array<uint8_t, 256> lengths{};		// 1 for the matching lengths.
+		std::vector<uint8_t> span_hits{};		// 1 for the cards with a covering range, empty for a term that isn't a number.
+		std::vector<int> span_cards{};			// The same cards, in the order found.
+		size_t estimate{};						// Cards listed by the three, an upper bound of the matches.
+	};
+
+	void match_term(const Query::Term& term, TermMatch& match) const;
+
+	// Whether an indexed card matches a term, no branches so the scan of a whole catalog doesn't stall.
+	uint8_t card_matches(size_t card, const TermMatch& match) const
+	{
+		return match.issuers[m_issuer_of[card]] | match.lengths[m_length_of[card]] | (match.span_hits.empty() ? 0 : match.span_hits[card]);
+	}
+
+	static constexpr size_t block_size{ 64 };
+
+	std::vector<uint32_t> m_issuer_of{};		// Issuer id of every card.
+	std::vector<uint8_t> m_length_of{};			// Length of every card, lengths above 255 are out of the index.
+	std::vector<std::string> m_names{};			// Lower case issuer names by id.
+	std::vector<int> m_issuer_cards{};			// Cards of every issuer, one issuer after the other.
+	std::vector<uint32_t> m_issuer_offsets{ 0 };	// First card of every issuer in m_issuer_cards, and the end.
+	std::vector<std::vector<int>> m_length_cards{};	// Cards of every length up to 255, by length.
+
+	std::vector<uint32_t> m_gram_keys{};		// Distinct n-grams of the names, ascending (see gram_key).
+	std::vector<uint32_t> m_gram_offsets{};		// First name of every n-gram in m_gram_names, and the end.
+	std::vector<uint32_t> m_gram_names{};		// Names that contain every n-gram.
+
+	std::vector<unsigned long long> m_span_lo{};	// Spans of every range, by start.
+	std::vector<unsigned long long> m_span_hi{};
+	std::vector<int> m_span_card{};
+	std::vector<unsigned long long> m_block_hi{};	// Largest end of every block_size spans.
+};
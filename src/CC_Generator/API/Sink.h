@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <memory>
+
+#if defined(_WIN64) || defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#endif
+
+/**
+ * @class Sink
+ * @brief Destination of the bytes written by File::export_cards.
+ */
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+
+    // Writes size bytes, returns false if the destination failed.
+    virtual bool write(const char* data, size_t size) = 0;
+
+    // Commits everything written so far to durable storage, returns false if that's not possible.
+    virtual bool sync() { return false; }
+
+    // Whether the sink needs to know the card of every record, see next_cards().
+    virtual bool wants_cards() const { return false; }
+
+    // Receives the catalog index of the card of each of the next count records, before their bytes are written.
+    virtual void next_cards(const int* /*cards*/, size_t /*count*/) {}
+
+    // Completes the output before the sink is destroyed, returns false if that failed.
+    virtual bool finish() { return true; }
+
+    // A short name of the sink type ("file", "stdout", "socket", "sqlite").
+    virtual const char* name() const = 0;
+};
+
+/**
+ * @class FileSink
+ * @brief Writes to a file opened with std::fopen, the file is closed when the sink is destroyed.
+ */
+class FileSink : public Sink
+{
+public:
+    explicit FileSink(std::FILE* file) : m_file{ file } {}
+    ~FileSink() override
+    {
+        if (m_file != nullptr)
+        {
+            std::fclose(m_file);
+        }
+    }
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    bool write(const char* data, size_t size) override
+    {
+        return std::fwrite(data, 1, size, m_file) == size;
+    }
+
+    /**
+     * @brief Flushes the file and asks the operating system to commit it to disk.
+     *
+     * @return True on success, false otherwise.
+     */
+    bool sync() override
+    {
+        if (std::fflush(m_file) != 0)
+        {
+            return false;
+        }
+#if defined(_WIN64) || defined(_WIN32)
+        return _commit(_fileno(m_file)) == 0;
+#else
+        return fsync(fileno(m_file)) == 0;
+#endif
+    }
+
+    const char* name() const override { return "file"; }
+
+private:
+    std::FILE* m_file{};
+};
+
+/**
+ * @class StdoutSink
+ * @brief Writes to the standard output.
+ */
+class StdoutSink : public Sink
+{
+public:
+    ~StdoutSink() override { std::fflush(stdout); }
+
+    bool write(const char* data, size_t size) override
+    {
+        return std::fwrite(data, 1, size, stdout) == size;
+    }
+
+    const char* name() const override { return "stdout"; }
+};
+
+#if !defined(_WIN64) && !defined(_WIN32)
+/**
+ * @class SocketSink
+ * @brief Writes to a connected stream socket, the socket is closed when the sink is destroyed.
+ */
+class SocketSink : public Sink
+{
+public:
+    explicit SocketSink(int fd) : m_fd{ fd } {}
+    ~SocketSink() override { close(m_fd); }
+
+    SocketSink(const SocketSink&) = delete;
+    SocketSink& operator=(const SocketSink&) = delete;
+
+    bool write(const char* data, size_t size) override
+    {
+        while (size > 0)
+        {
+            ssize_t n{ send(m_fd, data, size, MSG_NOSIGNAL) };
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    const char* name() const override { return "socket"; }
+
+    /**
+     * @brief Connects to a socket address.
+     *
+     * @param address "unix:<path>" for a Unix domain socket or "tcp:<host>:<port>".
+     * @param err_msg Receives a description of the failure.
+     * @return The connected sink, nullptr on failure.
+     */
+    static std::unique_ptr<Sink> connect_to(const std::string& address, std::string& err_msg)
+    {
+        int fd{ -1 };
+        if (address.compare(0, 5, "unix:") == 0)
+        {
+            sockaddr_un addr{};
+            std::string path{ address.substr(5) };
+            if (path.empty() || path.size() >= sizeof(addr.sun_path))
+            {
+                err_msg = "Invalid socket path: " + path;
+                return nullptr;
+            }
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd != -1 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+        else if (address.compare(0, 4, "tcp:") == 0)
+        {
+            size_t colon{ address.rfind(':') };
+            std::string host{ address.substr(4, colon - 4) };
+            std::string port{ address.substr(colon + 1) };
+            addrinfo hints{};
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* result{ nullptr };
+
+            if (colon <= 4 || getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+            {
+                err_msg = "Invalid address: " + address;
+                return nullptr;
+            }
+            for (addrinfo* ai{ result }; ai != nullptr && fd == -1; ai = ai->ai_next)
+            {
+                fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+                if (fd != -1 && connect(fd, ai->ai_addr, ai->ai_addrlen) == -1)
+                {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            freeaddrinfo(result);
+        }
+        else
+        {
+            err_msg = "Unknown socket address: " + address;
+            return nullptr;
+        }
+
+        if (fd == -1)
+        {
+            err_msg = "Couldn't connect to " + address + ": " + std::string(std::strerror(errno));
+            return nullptr;
+        }
+        return std::unique_ptr<Sink>(new SocketSink(fd));
+    }
+
+private:
+    int m_fd{ -1 };
+};
+#endif
@@ -0,0 +1,289 @@
+#include "SqliteSink.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+/**
+ * @brief Quotes an SQL identifier, doubling the quotes inside it.
+ */
+static std::string quote_identifier(const std::string& name)
+{
+	std::string quoted{ "\"" };
+	for (char c : name)
+	{
+		quoted += c;
+		if (c == '"')
+		{
+			quoted += '"';
+		}
+	}
+	return quoted + "\"";
+}
+
+/**
+ * @brief Opens the output database and replaces the table the cards go to.
+ *
+ * The connection is tuned for a single bulk write: no rollback journal, no syncs and an
+ * exclusive lock. The page cache keeps its default size, a larger one slows down the sort of
+ * the final CREATE INDEX. The insert statements are prepared here and reused for every row.
+ * Card catalogs are refused, the export would take them out of WAL mode.
+ *
+ * @param path The database file, created if it doesn't exist.
+ * @param catalog The catalog being exported, the issuer columns are taken from it.
+ * @param options The table and its columns.
+ * @param err_msg Receives a description of the failure.
+ * @return The sink, nullptr on failure.
+ */
+std::unique_ptr<SqliteSink> SqliteSink::open(const std::string& path, std::shared_ptr<const Catalog> catalog, const Options& options, std::string& err_msg)
+{
+	if (options.table.empty())
+	{
+		err_msg = "The table name is empty";
+		return nullptr;
+	}
+
+	sqlite3* db{ nullptr };
+	if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+	{
+		err_msg = "Failed to open the database: " + std::string(db != nullptr ? sqlite3_errmsg(db) : "out of memory");
+		sqlite3_close(db);
+		return nullptr;
+	}
+
+	std::unique_ptr<SqliteSink> sink{ new SqliteSink(db, options) };
+	const std::string table{ quote_identifier(options.table) };
+	std::string columns{ options.issuer_columns ? "(pan TEXT NOT NULL, issuer TEXT, length INTEGER)" : "(pan TEXT NOT NULL)" };
+	std::string row{ options.issuer_columns ? "(?,?,?)" : "(?)" };
+	std::string insert{ "INSERT INTO " + table + (options.issuer_columns ? "(pan, issuer, length)" : "(pan)") + " VALUES " };
+	std::string insert_many{ insert };
+	for (int i{}; i < rows_per_insert; i++)
+	{
+		insert_many += (i > 0 ? "," : "") + row;
+	}
+
+	// the pragmas below would take a catalog out of WAL mode and an export could replace its tables
+	sqlite3_stmt* stmt{ nullptr };
+	bool is_catalog{ false };
+	if (sqlite3_prepare_v2(db, "SELECT sum(name IN ('issuers', 'ranges')) = 2 OR sum(name = 'cards_table') > 0 FROM sqlite_master WHERE type='table'", -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		is_catalog = sqlite3_column_int(stmt, 0) != 0;
+	}
+	sqlite3_finalize(stmt);
+	if (is_catalog)
+	{
+		err_msg = path + " is a card catalog, export to another database";
+		sink->m_finished = true;
+		return nullptr;
+	}
+
+	if (sink->exec("PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF; PRAGMA locking_mode=EXCLUSIVE;") == false
+		|| sink->exec("DROP TABLE IF EXISTS " + table + "; CREATE TABLE " + table + columns + ";") == false
+		|| sqlite3_prepare_v3(db, insert_many.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &sink->m_insert_many, nullptr) != SQLITE_OK
+		|| sqlite3_prepare_v3(db, (insert + row).c_str(), -1, SQLITE_PREPARE_PERSISTENT, &sink->m_insert_one, nullptr) != SQLITE_OK
+		|| sink->exec("BEGIN") == false)
+	{
+		err_msg = "Failed to prepare the table " + options.table + ": " + (sink->m_error.empty() ? std::string(sqlite3_errmsg(db)) : sink->m_error);
+		sink->m_finished = true;
+		return nullptr;
+	}
+
+	sink->m_catalog = std::move(catalog);
+	return sink;
+}
+
+/**
+ * @brief Checks the extension of a path against the usual SQLite database extensions.
+ */
+bool SqliteSink::is_database_path(const std::string& path)
+{
+	std::string lower{ path };
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	for (const std::string extension : { ".db", ".sqlite", ".sqlite3" })
+	{
+		if (lower.size() > extension.size() && lower.compare(lower.size() - extension.size(), extension.size(), extension) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Finishes the table if finish() wasn't called and closes the database.
+ */
+SqliteSink::~SqliteSink()
+{
+	if (m_finished == false)
+	{
+		finish();
+	}
+	sqlite3_finalize(m_insert_many);
+	sqlite3_finalize(m_insert_one);
+	sqlite3_close(m_db);
+}
+
+/**
+ * @brief Splits the bytes into records and inserts every complete group of rows_per_insert records.
+ *
+ * Records are separated by '\n' (the first one has none before it), the record at the end of
+ * the bytes stays open until the next write or finish(). The bytes are copied once, into
+ * the pending buffer the statements are bound to.
+ *
+ * @return True on success, false if an insert failed.
+ */
+bool SqliteSink::write(const char* data, size_t size)
+{
+	const char* end{ data + size };
+	while (data < end)
+	{
+		const char* newline{ static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data))) };
+		if (newline == nullptr)
+		{
+			m_pending.append(data, end);
+			break;
+		}
+		m_pending.append(data, newline);
+		m_ends.push_back(m_pending.size());
+		data = newline + 1;
+	}
+	return flush(false);
+}
+
+/**
+ * @brief Queues the cards of the next records, for the issuer columns.
+ */
+void SqliteSink::next_cards(const int* cards, size_t count)
+{
+	m_cards.insert(m_cards.end(), cards, cards + count);
+}
+
+/**
+ * @brief Inserts the open record and the pending rows, commits and indexes the numbers.
+ *
+ * @return True on success, false otherwise (see error()).
+ */
+bool SqliteSink::finish()
+{
+	if (m_finished)
+	{
+		return m_error.empty();
+	}
+	m_finished = true;
+
+	if (flush(true) == false || exec("COMMIT") == false)
+	{
+		return false;
+	}
+	if (m_options.index)
+	{
+		return exec("CREATE INDEX IF NOT EXISTS " + quote_identifier(m_options.table + "_pan") + " ON " + quote_identifier(m_options.table) + "(pan)");
+	}
+	return true;
+}
+
+/**
+ * @brief Runs SQL without results, the error goes to m_error.
+ */
+bool SqliteSink::exec(const std::string& sql)
+{
+	char* errmsg{ nullptr };
+	if (sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &errmsg) != SQLITE_OK)
+	{
+		m_error = errmsg != nullptr ? errmsg : sqlite3_errmsg(m_db);
+		sqlite3_free(errmsg);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Binds count pending records to stmt and steps it once.
+ *
+ * The numbers and issuers are bound without copying, they stay in place until the step is done.
+ * The transaction is committed and a new one begun every rows_per_transaction rows.
+ *
+ * @param stmt m_insert_many for rows_per_insert records, m_insert_one for one.
+ * @param first Index of the first record in m_ends.
+ * @param count The number of rows stmt inserts.
+ * @return True on success, false otherwise.
+ */
+bool SqliteSink::insert(sqlite3_stmt* stmt, size_t first, size_t count)
+{
+	int param{ 1 };
+	for (size_t i{ first }; i < first + count; i++)
+	{
+		size_t begin{ i > 0 ? m_ends[i - 1] : 0 };
+		sqlite3_bind_text(stmt, param++, m_pending.data() + begin, static_cast<int>(m_ends[i] - begin), SQLITE_STATIC);
+		if (m_options.issuer_columns)
+		{
+			if (i < m_cards.size() && static_cast<size_t>(m_cards[i]) < m_catalog->size())
+			{
+				std::string_view issuer{ m_catalog->issuer(m_cards[i]) };
+				sqlite3_bind_text(stmt, param++, issuer.data(), static_cast<int>(issuer.size()), SQLITE_STATIC);
+				sqlite3_bind_int(stmt, param++, m_catalog->length(m_cards[i]));
+			}
+			else
+			{
+				sqlite3_bind_null(stmt, param++);
+				sqlite3_bind_null(stmt, param++);
+			}
+		}
+	}
+
+	int rc{ sqlite3_step(stmt) };
+	sqlite3_reset(stmt);
+	if (rc != SQLITE_DONE)
+	{
+		m_error = sqlite3_errmsg(m_db);
+		return false;
+	}
+
+	m_rows += count;
+	m_uncommitted += count;
+	if (m_uncommitted >= rows_per_transaction)
+	{
+		m_uncommitted = 0;
+		return exec("COMMIT") && exec("BEGIN");
+	}
+	return true;
+}
+
+/**
+ * @brief Inserts the complete records in groups of rows_per_insert and drops them from the buffer.
+ *
+ * @param all Also insert the records left over by the groups and the open record, one by one.
+ * @return True on success, false otherwise.
+ */
+bool SqliteSink::flush(bool all)
+{
+	if (all && m_pending.size() > (m_ends.empty() ? 0 : m_ends.back()))
+	{
+		m_ends.push_back(m_pending.size());
+	}
+
+	size_t done{};
+	bool ok{ true };
+	while (ok && m_ends.size() - done >= rows_per_insert)
+	{
+		ok = insert(m_insert_many, done, rows_per_insert);
+		done += rows_per_insert;
+	}
+	while (ok && all && done < m_ends.size())
+	{
+		ok = insert(m_insert_one, done, 1);
+		done++;
+	}
+
+	if (done > 0)
+	{
+		size_t bytes{ m_ends[done - 1] };
+		m_pending.erase(0, bytes);
+		m_ends.erase(m_ends.begin(), m_ends.begin() + done);
+		for (size_t& end : m_ends)
+		{
+			end -= bytes;
+		}
+		m_cards.erase(m_cards.begin(), m_cards.begin() + std::min(done, m_cards.size()));
+	}
+	return ok;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "Sink.h"
+#include "Catalog.h"
+#include "Dependencies/sqlite/sqlite3.h"
+
+/**
+ * @class SqliteSink
+ * @brief Writes the exported cards as rows of a table in an SQLite database.
+ *
+ * The records written by File::export_cards are split on '\n' and inserted with one prepared
+ * statement that holds rows_per_insert rows, rebound for every group of rows, inside
+ * transactions of rows_per_transaction rows. The output database runs with journal_mode=OFF
+ * and synchronous=OFF: it is a bulk artifact that is written once, an interrupted export leaves
+ * the committed rows and nothing to recover. The index on the numbers is created once all the
+ * rows are in, a sort of the finished table is faster than updating the index on every insert.
+ *
+ * With issuer columns every row also gets the issuer and the length of its card, which the
+ * sink learns from next_cards(). An existing table of the same name is replaced, like a file
+ * export replaces the file.
+ */
+class SqliteSink : public Sink
+{
+public:
+	// How the rows are stored.
+	struct Options
+	{
+		std::string table{ "cards" };	// Replaced if it exists.
+		bool issuer_columns{ false };	// Also store the issuer and length of every card.
+		bool index{ true };				// Index the numbers once the export ends.
+	};
+
+	// Opens (or creates) the database at path and prepares the table, returns nullptr on failure.
+	static std::unique_ptr<SqliteSink> open(const std::string& path, std::shared_ptr<const Catalog> catalog, const Options& options, std::string& err_msg);
+
+	// Whether path names an SQLite database (.db, .sqlite or .sqlite3).
+	static bool is_database_path(const std::string& path);
+
+	~SqliteSink() override;
+
+	SqliteSink(const SqliteSink&) = delete;
+	SqliteSink& operator=(const SqliteSink&) = delete;
+
+	bool write(const char* data, size_t size) override;
+	bool wants_cards() const override { return m_options.issuer_columns; }
+	void next_cards(const int* cards, size_t count) override;
+	const char* name() const override { return "sqlite"; }
+
+	// Inserts the pending rows, commits and creates the index, returns false on failure (see error()).
+	bool finish() override;
+
+	// The last SQLite error.
+	const std::string& error() const { return m_error; }
+
+	// Rows inserted so far.
+	unsigned long long rows() const { return m_rows; }
+
+	static constexpr int rows_per_insert{ 64 };
+	static constexpr unsigned long long rows_per_transaction{ 1ULL << 20 };
+
+private:
+	SqliteSink(sqlite3* db, const Options& options) : m_db{ db }, m_options{ options } {}
+
+	bool exec(const std::string& sql);
+	bool insert(sqlite3_stmt* stmt, size_t first, size_t count);
+	bool flush(bool all);
+
+	sqlite3* m_db{};
+	sqlite3_stmt* m_insert_many{};
+	sqlite3_stmt* m_insert_one{};
+	Options m_options{};
+	std::shared_ptr<const Catalog> m_catalog{};	// The issuer columns are bound straight from it.
+
+	std::string m_pending{};				// Records not inserted yet, the last one may still be open.
+	std::vector<size_t> m_ends{};			// End offset of each complete record in m_pending.
+	std::vector<int> m_cards{};				// Card of each record in m_pending and of the records to come.
+	unsigned long long m_rows{};
+	unsigned long long m_uncommitted{};
+	bool m_finished{ false };
+	std::string m_error{};
+};
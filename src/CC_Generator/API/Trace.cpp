@@ -0,0 +1,169 @@
+#include "Trace.h"
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <vector>
+
+std::atomic<bool> Trace::s_recording{ false };
+std::atomic<unsigned long long> Trace::s_sample_every{ 1 };
+
+// A closed span.
+struct TraceEvent
+{
+	const char* name{};
+	uint32_t thread{};
+	unsigned long long batch{};
+	std::chrono::steady_clock::time_point start{};
+	std::chrono::steady_clock::time_point end{};
+};
+
+static std::mutex s_mutex{};
+static std::vector<TraceEvent> s_events{};
+static unsigned long long s_dropped{};
+static std::chrono::steady_clock::time_point s_origin{};
+
+/**
+ * @brief Returns a small number that identifies the calling thread in the trace.
+ */
+static uint32_t thread_id()
+{
+	static std::atomic<uint32_t> next{ 1 };
+	thread_local uint32_t id{ next++ };
+	return id;
+}
+
+/**
+ * @brief Adds a span to the recording, unless it was stopped or is full.
+ */
+static void add_event(const TraceEvent& event)
+{
+	std::lock_guard<std::mutex> lock{ s_mutex };
+	if (Trace::recording() == false)
+	{
+		return;
+	}
+	if (s_events.size() >= Trace::max_events)
+	{
+		s_dropped++;
+		return;
+	}
+	s_events.push_back(event);
+}
+
+/**
+ * @brief Starts a batch, deciding whether its stages are recorded.
+ *
+ * The span still open is closed first, so the last stage of a batch ends where the next
+ * batch starts.
+ *
+ * @param batch The index of the batch in the export.
+ */
+void Trace::Track::batch(unsigned long long batch)
+{
+	unsigned long long every{ s_sample_every.load(std::memory_order_relaxed) };
+	if (m_sampled)
+	{
+		close(std::chrono::steady_clock::now());
+	}
+	m_sampled = recording() && batch % every == 0;
+	m_batch = batch;
+}
+
+/**
+ * @brief Closes the span of the current stage and opens the span of stage.
+ *
+ * Does nothing but a branch when the batch isn't sampled.
+ *
+ * @param stage The name of the stage, it must outlive the recording (a string literal).
+ */
+void Trace::Track::enter(const char* stage)
+{
+	if (m_sampled == false)
+	{
+		return;
+	}
+	std::chrono::steady_clock::time_point now{ std::chrono::steady_clock::now() };
+	close(now);
+	m_stage = stage;
+	m_start = now;
+}
+
+/**
+ * @brief Records the open span, if there is one.
+ */
+void Trace::Track::close(std::chrono::steady_clock::time_point now)
+{
+	if (m_stage != nullptr)
+	{
+		add_event(TraceEvent{ m_stage, thread_id(), m_batch, m_start, now });
+		m_stage = nullptr;
+	}
+}
+
+/**
+ * @brief Starts recording.
+ *
+ * @param sample_every Record one batch in every sample_every, 1 records them all.
+ */
+void Trace::start(unsigned long long sample_every)
+{
+	std::lock_guard<std::mutex> lock{ s_mutex };
+	s_events.clear();
+	s_dropped = 0;
+	s_origin = std::chrono::steady_clock::now();
+	s_sample_every = sample_every > 0 ? sample_every : 1;
+	s_recording = true;
+}
+
+/**
+ * @brief Stops recording and writes the events in the Chrome trace event format.
+ *
+ * The events are complete events ("ph": "X") in microseconds since start(), with a
+ * thread_name metadata event for every thread. The recording is discarded either way.
+ *
+ * @param path The file to write.
+ * @param events Receives the number of events written.
+ * @return True if the file was written, false otherwise.
+ */
+bool Trace::stop(const std::string& path, size_t& events)
+{
+	std::vector<TraceEvent> recorded{};
+	unsigned long long dropped{};
+	std::chrono::steady_clock::time_point origin{};
+	{
+		std::lock_guard<std::mutex> lock{ s_mutex };
+		s_recording = false;
+		recorded.swap(s_events);
+		dropped = s_dropped;
+		origin = s_origin;
+	}
+	events = recorded.size();
+
+	std::FILE* file{ std::fopen(path.c_str(), "wb") };
+	if (file == nullptr)
+	{
+		return false;
+	}
+	auto micros = [origin](std::chrono::steady_clock::time_point time) { return std::chrono::duration<double, std::micro>(time - origin).count(); };
+
+	std::fprintf(file, "{\"traceEvents\":[\n");
+	std::set<uint32_t> threads{};
+	for (const TraceEvent& event : recorded)
+	{
+		threads.insert(event.thread);
+	}
+	const char* separator{ "" };
+	for (uint32_t thread : threads)
+	{
+		std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"export %u\"}}", separator, thread, thread);
+		separator = ",\n";
+	}
+	for (const TraceEvent& event : recorded)
+	{
+		std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"export\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"batch\":%llu}}",
+			separator, event.name, event.thread, micros(event.start), micros(event.end) - micros(event.start), event.batch);
+		separator = ",\n";
+	}
+	std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"sample_every\":\"%llu\",\"dropped\":\"%llu\"}}\n", s_sample_every.load(), dropped);
+	return std::fclose(file) == 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class Trace
+ * @brief Records the stages of exports as spans of a Chrome trace (chrome://tracing, Perfetto).
+ *
+ * Recording is started and stopped at run time, also while an export runs. An export traces
+ * one batch in every sample_every: each stage of a sampled batch (generating, writing, waiting,
+ * paused) becomes a complete event on the track of the export thread, with the batch index as
+ * its argument. A batch takes about a millisecond and yields a handful of events, so the
+ * overhead stays far below a percent even when every batch is sampled.
+ *
+ * The instrumentation is compiled only with CCGEN_TRACING (the CMake option of the same name);
+ * without it the exporter contains no tracing code at all and available() is false.
+ */
+class Trace
+{
+public:
+	// The spans of one thread, the stage that runs is the open span.
+	class Track
+	{
+	public:
+		// Starts a batch, its stages are recorded if recording is on and the batch is sampled.
+		void batch(unsigned long long batch);
+
+		// Closes the span of the current stage and opens one for stage, a static string.
+		void enter(const char* stage);
+
+	private:
+		void close(std::chrono::steady_clock::time_point now);
+
+		bool m_sampled{};
+		unsigned long long m_batch{};
+		const char* m_stage{};
+		std::chrono::steady_clock::time_point m_start{};
+	};
+
+	// Starts recording, replacing the events of a previous recording that wasn't stopped.
+	static void start(unsigned long long sample_every);
+
+	// Stops recording and writes the events to path as Chrome trace JSON, events receives their number.
+	static bool stop(const std::string& path, size_t& events);
+
+	// Whether a recording is running.
+	static bool recording() { return s_recording.load(std::memory_order_relaxed); }
+
+	// Whether the build includes the instrumentation.
+	static constexpr bool available()
+	{
+#if defined(CCGEN_TRACING)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static constexpr size_t max_events{ 1 << 20 };	// Events kept by a recording, later ones are counted as dropped.
+
+private:
+	static std::atomic<bool> s_recording;
+	static std::atomic<unsigned long long> s_sample_every;
+};
@@ -0,0 +1,38 @@
+#include "Ccgen.h"
+
+SQLITE_EXTENSION_INIT1
+
+#if defined(_WIN64) || defined(_WIN32)
+#define CCGEN_EXPORT __declspec(dllexport)
+#else
+#define CCGEN_EXPORT
+#endif
+
+/**
+ * @brief The entry point of the ccgen loadable extension.
+ *
+ * SQLite derives the name from the file name, so ".load ./libccgen" (or ccgen.dll) finds
+ * it without naming the entry point. The extension is built with CCGEN_EXTENSION, which
+ * routes every SQLite call of the catalog code through the API table of the host.
+ *
+ * @param db The connection loading the extension.
+ * @param err_msg Receives the reason the module or the functions couldn't be registered, SQLite reports it.
+ * @param api The SQLite API of the host.
+ * @return SQLITE_OK if the module and the functions were registered, an SQLite error code otherwise.
+ */
+extern "C" CCGEN_EXPORT int sqlite3_ccgen_init(sqlite3* db, char** err_msg, const sqlite3_api_routines* api)
+{
+    SQLITE_EXTENSION_INIT2(api);
+    int rc{ Ccgen::register_module(db) };
+    if (rc != SQLITE_OK)
+    {
+        *err_msg = sqlite3_mprintf("ccgen: couldn't register the ccgen module: %s", sqlite3_errstr(rc));
+        return rc;
+    }
+    rc = Ccgen::register_functions(db);
+    if (rc != SQLITE_OK)
+    {
+        *err_msg = sqlite3_mprintf("ccgen: couldn't register the SQL functions: %s", sqlite3_errstr(rc));
+    }
+    return rc;
+}
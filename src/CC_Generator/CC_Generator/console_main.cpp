@@ -28,6 +28,12 @@ const std::string license{ "AGPL V3" };
  */
 int main(int argc, char* argv[])
 {
+    // any argument selects the non-interactive batch mode
+    if (argc > 1)
+    {
+        return console::batch(argc, argv);
+    }
+
     console::run(version, project_url, license);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "Daemon.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+
+const std::string version{ "2.0.1" };
+const std::string default_socket_path{ "/tmp/cc_generator.sock" };
+const std::string default_db_path{ "cards.db" };
+
+/**
+ * @brief The main entry point for the generator daemon.
+ *
+ * Usage: CC_Generator_Daemon [-s socket_path] [-p http_port] [-d db_path]
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ *
+ * @return 0 on a clean shutdown, 1 otherwise.
+ */
+int main(int argc, char* argv[])
+{
+    std::string socket_path{ default_socket_path };
+    std::string db_path{ default_db_path };
+    int http_port{};
+
+    int opt{};
+    while ((opt = getopt(argc, argv, "s:p:d:hv")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'p':
+            http_port = std::atoi(optarg);
+            if (http_port <= 0 || http_port > 65535)
+            {
+                std::cerr << "Invalid port: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'd':
+            db_path = optarg;
+            break;
+        case 'v':
+            std::cout << "CC_Generator_Daemon " << version << std::endl;
+            return 0;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-s socket_path] [-p http_port] [-d db_path]" << std::endl;
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    return server::run(socket_path, http_port, db_path);
+}
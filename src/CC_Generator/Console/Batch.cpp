@@ -0,0 +1,593 @@
+#include "Console.h"
+#include "Importer.h"
+#include "Linter.h"
+#include "SqliteSink.h"
+#include <csignal>
+#include <cerrno>
+
+/**
+ * @brief Signal handler of batch mode.
+ *
+ * Stops the export at the next batch boundary, the exporter then flushes what it
+ * generated and writes a final checkpoint.
+ */
+static void handle_stop_signal(int)
+{
+	g_started = false;
+}
+
+/**
+ * @brief Prints the command-line usage of batch mode.
+ *
+ * @param program The name the program was started with.
+ */
+static void print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " --output TARGET (--count N | --bytes SIZE | --time DURATION) [options]\n"
+		<< "       " << program << " --output PATH --resume [options]\n"
+		<< "       " << program << " --import FILE [--columns MAP] [--delimiter comma|tab] [--header] [--length N] [--rejects PATH] [--db PATH]\n"
+		<< "       " << program << " --lint [--merge] [--db PATH]\n\n"
+		<< "  --db PATH                    The catalog to read (default: cards.db)\n"
+		<< "  --issuer NAME[,NAME...]      Issuers to generate, case-insensitive (default: all)\n"
+		<< "  --count N                    Number of cards to generate\n"
+		<< "  --bytes SIZE[K|M|G|T]        Stop on the last card that fits in SIZE bytes\n"
+		<< "  --time DURATION[s|m|h]       Stop after generating for DURATION (default unit: seconds)\n"
+		<< "  --output TARGET              The file to write, \"-\" for stdout, unix:PATH or tcp:HOST:PORT for a socket,\n"
+		<< "                               sqlite:PATH for a table of an SQLite database\n"
+		<< "  --seed N                     Seed of the export, the same seed reproduces the same file\n"
+		<< "  --checkpoint-interval SEC    Seconds between checkpoints, 0 disables them (default: 10)\n"
+		<< "  --trace PATH                 Record the stages of the export as a Chrome trace (chrome://tracing, Perfetto)\n"
+		<< "  --trace-sample N             With --trace, record one batch of 4096 cards in every N (default: 1)\n"
+		<< "  --report PATH                Write a JSON report of the export to PATH (default: PATH.report.json\n"
+		<< "                               when PATH or sqlite:PATH is a regular file, none otherwise)\n"
+		<< "  --resume                     Continue the export recorded in PATH.ckpt\n"
+		<< "  --rate N                     Limit the output to N cards per second\n"
+		<< "  --ramp SHAPE                 Vary the rate: linear:END:SEC, step:INCREMENT:SEC or sine:AMPLITUDE:PERIOD\n"
+		<< "  --table NAME                 With sqlite:PATH, the table to (re)create (default: cards)\n"
+		<< "  --with-issuer                With sqlite:PATH, also store the issuer and length of every card\n"
+		<< "  --import FILE                Add the BIN ranges of a CSV/TSV file to the catalog\n"
+		<< "  --columns MAP                Columns of the file, by 1-based index or header name (default: issuer=1,length=2,prefixes=3)\n"
+		<< "  --delimiter comma|tab        Field delimiter of the file (default: tab for .tsv files, comma otherwise)\n"
+		<< "  --header                     The first row of the file is a header\n"
+		<< "  --length N                   Card length of every row when the file has no length column\n"
+		<< "  --rejects PATH               Write the rejected rows, their line and the reason to PATH\n"
+		<< "  --lint                       Report overlapping, duplicate, shadowed, adjacent and too long ranges\n"
+		<< "  --merge                      With --lint, merge the ranges of every card and save the catalog\n\n"
+		<< "Whichever of --count, --bytes and --time is reached first ends the export.\n"
+		<< "Checkpoints and --resume are only available when writing to a file.\n"
+		<< "--lint exits with 3 when it finds problems.\n";
+}
+
+/**
+ * @brief Parses an unsigned decimal number.
+ *
+ * @param str The string to parse, may be nullptr.
+ * @param value Receives the number.
+ * @return True if str is a non-empty string of digits that fits in value, false otherwise.
+ */
+static bool parse_number(const char* str, unsigned long long& value)
+{
+	if (str == nullptr || *str == '\0' || std::string(str).find_first_not_of("0123456789") != std::string::npos)
+	{
+		return false;
+	}
+	errno = 0;
+	value = std::strtoull(str, nullptr, 10);
+	return errno == 0;
+}
+
+/**
+ * @brief Parses a number followed by an optional unit suffix.
+ *
+ * @param str The string to parse, may be nullptr.
+ * @param units The accepted suffixes.
+ * @param multipliers The multiplier of every suffix in units.
+ * @param value Receives the number multiplied by the suffix.
+ * @return True if str is a valid number with a known suffix and the result fits in value, false otherwise.
+ */
+static bool parse_quantity(const char* str, const std::string& units, const std::vector<unsigned long long>& multipliers, unsigned long long& value)
+{
+	if (str == nullptr)
+	{
+		return false;
+	}
+	std::string number{ str };
+	unsigned long long multiplier{ 1 };
+	size_t unit{ number.empty() ? std::string::npos : units.find(static_cast<char>(std::toupper(static_cast<unsigned char>(number.back())))) };
+	if (unit != std::string::npos)
+	{
+		multiplier = multipliers[unit];
+		number.pop_back();
+	}
+	if (parse_number(number.c_str(), value) == false || value > File::unlimited / multiplier)
+	{
+		return false;
+	}
+	value *= multiplier;
+	return true;
+}
+
+/**
+ * @brief Imports a BIN list into the catalog and prints the counters of the import.
+ *
+ * @param db_path The catalog to add the ranges to, created if it doesn't exist.
+ * @param import_path The CSV/TSV file to import.
+ * @param options The column mapping and the delimiter of the file.
+ * @return 0 if the import completed, 1 on error.
+ *
+ * @see Importer::import_file
+ */
+static int run_import(const std::string& db_path, const std::string& import_path, const Importer::Options& options)
+{
+	std::string err_msg{};
+	std::shared_ptr<CatalogDb> db{ CatalogDb::open(db_path, CatalogDb::Mode::read_write, err_msg) };
+	if (db == nullptr)
+	{
+		std::cerr << "Failed to read the database \"" << db_path << "\". " << err_msg << std::endl;
+		return 1;
+	}
+
+	Importer::Result result{};
+	auto start = std::chrono::steady_clock::now();
+	int rc{ Importer::import_file(db, import_path, options, result, err_msg) };
+	double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+	std::cerr << "Read " << result.records << " rows in " << std::fixed << std::setprecision(2) << seconds << " s: "
+		<< result.ranges << " ranges added, " << result.existing << " already in the catalog, " << result.rejected << " rejected" << std::endl;
+	if (result.rejected > 0 && options.rejects_path.empty() == false)
+	{
+		std::cerr << "The rejected rows are listed in \"" << options.rejects_path << "\"" << std::endl;
+	}
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << err_msg << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Lints the catalog and prints a line for every finding.
+ *
+ * With merge the duplicate, shadowed, overlapping and adjacent ranges of every card are
+ * merged and the catalog is saved before the findings that remain are printed.
+ *
+ * @param db_path The catalog to lint.
+ * @param merge Whether to merge the ranges and save the catalog.
+ * @return 0 if the catalog is clean, 3 if there are findings, 1 on error.
+ *
+ * @see Linter::lint
+ * @see Linter::merge
+ */
+static int run_lint(const std::string& db_path, bool merge)
+{
+	std::string err_msg{};
+	std::vector<Card> cards_vec{};
+	std::shared_ptr<CatalogDb> db{ DB_API::check_file_exists(db_path) ? DB_API::read_db(db_path, merge ? CatalogDb::Mode::read_write : CatalogDb::Mode::read_only) : nullptr };
+	if (db == nullptr || DB_API::read_cards(db, cards_vec, err_msg) != SQLITE_OK)
+	{
+		std::cerr << "Failed to read the database \"" << db_path << "\". " << err_msg << std::endl;
+		return 1;
+	}
+
+	if (merge)
+	{
+		size_t removed{ Linter::merge(cards_vec) };
+		if (DB_API::write_cards(db, cards_vec, err_msg) != SQLITE_OK)
+		{
+			std::cerr << "Failed to save the database \"" << db_path << "\". " << err_msg << std::endl;
+			return 1;
+		}
+		std::cerr << "Merged the ranges of the catalog, " << removed << " ranges removed" << std::endl;
+	}
+
+	std::vector<Linter::Finding> findings{ Linter::lint(cards_vec) };
+	for (const auto& finding : findings)
+	{
+		std::cout << Linter::describe(cards_vec, finding) << "\n";
+	}
+	std::cout.flush();
+	std::cerr << findings.size() << " findings in " << cards_vec.size() << " cards" << std::endl;
+	return findings.empty() ? 0 : 3;
+}
+
+/**
+ * @brief Runs a non-interactive export described by the command-line arguments.
+ *
+ * The selected cards are written to the output file the same way the interactive modes do,
+ * with periodic checkpoints in "<output>.ckpt". SIGINT and SIGTERM stop the export after
+ * the current batch and leave a final checkpoint, "--resume" truncates the output to the
+ * checkpoint and continues it to the same file an uninterrupted run would have produced.
+ *
+ * The export ends after "--count" cards, on the last card that fits in "--bytes" or after
+ * "--time" of generation, whichever comes first.
+ *
+ * The output can also be the standard output, a socket or a table of an SQLite database
+ * ("sqlite:PATH"), and "--rate"/"--ramp" pace the export for load testing, the achieved rate
+ * and the wakeup jitter are reported at the end.
+ *
+ * "--trace" records the stages of the export as a Chrome trace (see Trace).
+ *
+ * Every export to a regular file also leaves a JSON report, "<output>.report.json", other
+ * outputs only with "--report" (see File::write_report).
+ *
+ * With "--import" the BIN ranges of a CSV/TSV file are added to the catalog instead, with
+ * "--lint" the catalog is checked for conflicting ranges.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if the export (or import) completed, 2 if it was interrupted, 3 if --lint found problems, 1 on error.
+ *
+ * @see File::export_cards
+ */
+int console::batch(int argc, char* argv[])
+{
+	std::string db_path{ "cards.db" };
+	std::string exp_path{};
+	std::vector<std::string> issuers{};
+	unsigned long long amount{};
+	unsigned long long seed{ File::random_seed() };
+	unsigned long long interval{ 10 };
+	unsigned long long max_bytes{};
+	unsigned long long time_budget{};
+	bool has_amount{ false };
+	bool resume{ false };
+	unsigned long long rate{};
+	std::string ramp{};
+	std::string import_path{};
+	std::string delimiter{};
+	Importer::Options import_options{};
+	unsigned long long import_length{};
+	bool lint{ false };
+	bool merge{ false };
+	SqliteSink::Options table_options{};
+	std::string report_path{};
+	std::string trace_path{};
+	unsigned long long trace_sample{ 1 };
+
+	for (int i{ 1 }; i < argc; i++)
+	{
+		std::string arg{ argv[i] };
+		const char* value{ i + 1 < argc ? argv[i + 1] : nullptr };
+		bool ok{ true };
+
+		if (arg == "--resume")
+		{
+			resume = true;
+			continue;
+		}
+		if (arg == "--with-issuer")
+		{
+			table_options.issuer_columns = true;
+			continue;
+		}
+		if (arg == "--header")
+		{
+			import_options.header = true;
+			continue;
+		}
+		if (arg == "--lint" || arg == "--merge")
+		{
+			lint = true;
+			merge = merge || arg == "--merge";
+			continue;
+		}
+		if (arg == "--help" || arg == "-h")
+		{
+			print_usage(argv[0]);
+			return 0;
+		}
+
+		if (arg == "--db" && value != nullptr)
+		{
+			db_path = value;
+		}
+		else if (arg == "--output" && value != nullptr)
+		{
+			exp_path = value;
+		}
+		else if (arg == "--issuer" && value != nullptr)
+		{
+			// a blank name must not fall back to every issuer
+			std::istringstream iss(value);
+			std::string issuer{};
+			size_t before{ issuers.size() };
+			while (ok && std::getline(iss, issuer, ','))
+			{
+				ok = Card::validate_issuer(issuer);
+				issuers.push_back(issuer);
+			}
+			ok = ok && issuers.size() > before;
+		}
+		else if (arg == "--count")
+		{
+			ok = has_amount = parse_number(value, amount);
+		}
+		else if (arg == "--bytes")
+		{
+			ok = parse_quantity(value, "KMGT", { 1ULL << 10, 1ULL << 20, 1ULL << 30, 1ULL << 40 }, max_bytes) && max_bytes > 0;
+		}
+		else if (arg == "--time")
+		{
+			ok = parse_quantity(value, "SMH", { 1, 60, 3600 }, time_budget) && time_budget > 0;
+		}
+		else if (arg == "--seed")
+		{
+			ok = parse_number(value, seed);
+		}
+		else if (arg == "--checkpoint-interval")
+		{
+			ok = parse_number(value, interval);
+		}
+		else if (arg == "--rate")
+		{
+			ok = parse_number(value, rate) && rate > 0;
+		}
+		else if (arg == "--ramp" && value != nullptr)
+		{
+			ramp = value;
+		}
+		else if (arg == "--import" && value != nullptr)
+		{
+			import_path = value;
+		}
+		else if (arg == "--columns" && value != nullptr)
+		{
+			ok = Importer::parse_columns(value, import_options);
+		}
+		else if (arg == "--delimiter" && value != nullptr)
+		{
+			delimiter = value;
+			ok = delimiter == "comma" || delimiter == "tab" || delimiter == "," || delimiter == "\\t";
+		}
+		else if (arg == "--length")
+		{
+			ok = parse_number(value, import_length) && Card::validate_length(static_cast<int>(std::min(import_length, 100ULL)));
+		}
+		else if (arg == "--rejects" && value != nullptr)
+		{
+			import_options.rejects_path = value;
+		}
+		else if (arg == "--table" && value != nullptr)
+		{
+			table_options.table = value;
+		}
+		else if (arg == "--report" && value != nullptr)
+		{
+			report_path = value;
+		}
+		else if (arg == "--trace" && value != nullptr)
+		{
+			trace_path = value;
+		}
+		else if (arg == "--trace-sample")
+		{
+			ok = parse_number(value, trace_sample) && trace_sample > 0;
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if (ok == false)
+		{
+			std::cerr << "Invalid argument: " << arg << "\n\n";
+			print_usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	if (import_path.empty() == false)
+	{
+		bool tsv{ import_path.size() >= 4 && import_path.compare(import_path.size() - 4, 4, ".tsv") == 0 };
+		import_options.delimiter = delimiter == "tab" || delimiter == "\\t" || (delimiter.empty() && tsv) ? '\t' : ',';
+		if (import_length > 0)
+		{
+			import_options.length = static_cast<int>(import_length);
+			import_options.length_column.clear();
+		}
+		return run_import(db_path, import_path, import_options);
+	}
+	if (lint)
+	{
+		return run_lint(db_path, merge);
+	}
+
+	if (exp_path.empty() || (resume == false && has_amount == false && max_bytes == 0 && time_budget == 0))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (trace_path.empty() == false && Trace::available() == false)
+	{
+		std::cerr << "--trace requires a build with CCGEN_TRACING" << std::endl;
+		return 1;
+	}
+
+	const bool to_stdout{ exp_path == "-" };
+	const bool to_socket{ exp_path.compare(0, 5, "unix:") == 0 || exp_path.compare(0, 4, "tcp:") == 0 };
+	const bool to_table{ exp_path.compare(0, 7, "sqlite:") == 0 };
+	if (resume && (to_stdout || to_socket || to_table))
+	{
+		std::cerr << "--resume requires a file output" << std::endl;
+		return 1;
+	}
+
+	Pacer::Profile profile{};
+	profile.rate = static_cast<double>(rate);
+	if (ramp.empty() == false && (rate == 0 || Pacer::parse_ramp(ramp, profile) == false))
+	{
+		std::cerr << "Invalid ramp: " << ramp << " (requires --rate)" << std::endl;
+		return 1;
+	}
+
+	// read the catalog
+	std::string err_msg{};
+	std::shared_ptr<const Catalog> catalog{};
+	std::shared_ptr<CatalogDb> db{ DB_API::check_file_exists(db_path) ? DB_API::read_db(db_path, CatalogDb::Mode::read_only) : nullptr };
+	if (db == nullptr || DB_API::read_catalog(db, catalog, err_msg) != SQLITE_OK)
+	{
+		std::cerr << "Failed to read the database \"" << db_path << "\". " << err_msg << std::endl;
+		return 1;
+	}
+	db.reset();
+
+	// select the requested issuers
+	std::vector<bool> cards_selection(catalog->size(), issuers.empty());
+	for (size_t i{}; i < catalog->size(); i++)
+	{
+		for (const auto& issuer : issuers)
+		{
+			std::string_view name{ catalog->issuer(i) };
+			cards_selection[i] = cards_selection[i] || std::equal(name.begin(), name.end(), issuer.begin(), issuer.end(),
+				[](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+		}
+	}
+	if (std::none_of(cards_selection.begin(), cards_selection.end(), [](bool value) { return value; }))
+	{
+		std::cerr << "No cards match the requested issuers" << std::endl;
+		return 1;
+	}
+
+	File::ExportOptions options{};
+	options.seed = seed;
+	options.max_bytes = max_bytes;
+	options.time_budget = std::chrono::seconds(time_budget);
+	amount = has_amount ? amount : File::unlimited;
+	options.checkpoint_interval = std::chrono::seconds(interval);
+	options.checkpoint_path = (interval > 0 || resume) && to_stdout == false && to_socket == false && to_table == false ? exp_path + ".ckpt" : "";
+	options.report_path = report_path;
+
+	std::unique_ptr<Sink> sink{};
+	std::FILE* output_file{ nullptr };
+	if (resume)
+	{
+		File::Checkpoint checkpoint{};
+		if (File::read_checkpoint(options.checkpoint_path, checkpoint) == false)
+		{
+			std::cerr << "Couldn't read the checkpoint \"" << options.checkpoint_path << "\"" << std::endl;
+			return 1;
+		}
+		if (checkpoint.fingerprint != File::catalog_fingerprint(*catalog, cards_selection))
+		{
+			std::cerr << "The catalog or the selected issuers changed since the checkpoint was written" << std::endl;
+			return 1;
+		}
+		if ((has_amount && amount != checkpoint.amount) || (max_bytes > 0 && max_bytes != checkpoint.max_bytes) ||
+			(time_budget > 0 && time_budget * 1000 != checkpoint.time_budget_ms))
+		{
+			std::cerr << "The checkpoint was written for a different --count, --bytes or --time" << std::endl;
+			return 1;
+		}
+
+		amount = checkpoint.amount;
+		options.seed = checkpoint.seed;
+		options.start_card = checkpoint.cards_emitted;
+		options.start_bytes = checkpoint.bytes_flushed;
+		options.max_bytes = checkpoint.max_bytes;
+		options.time_budget = std::chrono::milliseconds(checkpoint.time_budget_ms);
+		options.start_elapsed = std::chrono::milliseconds(checkpoint.elapsed_ms);
+		output_file = File::open_for_resume(exp_path, checkpoint);
+	}
+	else if (to_stdout)
+	{
+		sink.reset(new StdoutSink());
+	}
+	else if (to_socket)
+	{
+#if defined(_WIN64) || defined(_WIN32)
+		err_msg = "Socket outputs are not supported on Windows";
+#else
+		sink = SocketSink::connect_to(exp_path, err_msg);
+#endif
+		if (sink == nullptr)
+		{
+			std::cerr << err_msg << std::endl;
+			return 1;
+		}
+	}
+	else if (to_table)
+	{
+		sink = SqliteSink::open(exp_path.substr(7), catalog, table_options, err_msg);
+		if (sink == nullptr)
+		{
+			std::cerr << err_msg << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		output_file = std::fopen(exp_path.c_str(), "wb");
+	}
+
+	if (sink == nullptr)
+	{
+		if (output_file == nullptr)
+		{
+			std::cerr << "Couldn't open the file \"" << exp_path << "\"" << std::endl;
+			return 1;
+		}
+		sink.reset(new FileSink(output_file));
+	}
+
+	// the report goes next to a regular file by default, a device or a FIFO needs --report
+	if (report_path.empty() && to_stdout == false && to_socket == false)
+	{
+		options.report_path = File::default_report_path(to_table ? exp_path.substr(7) : exp_path);
+	}
+
+	std::unique_ptr<Pacer> pacer{ rate > 0 ? new Pacer(profile) : nullptr };
+	options.pacer = pacer.get();
+
+	std::signal(SIGINT, handle_stop_signal);
+	std::signal(SIGTERM, handle_stop_signal);
+
+	g_paused = false;
+	g_started = true;
+	if (trace_path.empty() == false)
+	{
+		Trace::start(trace_sample);
+	}
+	File::ExportResult result{ File::export_cards(std::move(sink), catalog, cards_selection, amount, options) };
+
+	if (trace_path.empty() == false)
+	{
+		size_t events{};
+		if (Trace::stop(trace_path, events))
+		{
+			std::cerr << "Wrote " << events << " trace events to \"" << trace_path << "\"" << std::endl;
+		}
+		else
+		{
+			std::cerr << "Couldn't write the trace \"" << trace_path << "\"" << std::endl;
+		}
+	}
+
+	if (options.report_path.empty() == false && result.report_written == false)
+	{
+		std::cerr << "Couldn't write the report \"" << options.report_path << "\"" << std::endl;
+	}
+
+	if (pacer != nullptr)
+	{
+		std::cerr << std::fixed << std::setprecision(1) << "Paced " << pacer->cards() << " cards in " << pacer->elapsed()
+			<< " s: " << pacer->achieved_rate() << " cards/s, wakeup jitter mean " << pacer->mean_jitter_us()
+			<< " us, max " << pacer->max_jitter_us() << " us" << std::endl;
+	}
+
+	if (result.complete == false)
+	{
+		std::cerr << "Stopped after " << result.cards << " cards";
+		if (options.checkpoint_path.empty() == false)
+		{
+			std::cerr << ", continue with --resume";
+		}
+		std::cerr << std::endl;
+		return 2;
+	}
+
+	std::cerr << "Wrote " << result.cards << " cards (" << result.bytes << " bytes) to \"" << exp_path << "\" (seed " << options.seed << ")" << std::endl;
+	return 0;
+}
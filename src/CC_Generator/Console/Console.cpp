@@ -49,20 +49,20 @@ bool console::internal::check_quit(const std::string& input)
 }
 
 /**
- * @brief Retrieves a shared pointer to an SQLite database.
+ * @brief Retrieves a shared pointer to a catalog session.
  *
  * This function prompts the user to enter the path to an SQLite database file.
  * If the user enters a valid path, it attempts to open the database and returns
- * a shared pointer to the opened database. If the user enters a quit command or
+ * a shared pointer to the session, which is kept for reading and saving the catalog. If the user enters a quit command or
  * if the database cannot be opened, it returns a nullptr.
  *
- * @return A shared pointer to the opened SQLite database if successful, nullptr otherwise.
+ * @return A shared pointer to the opened session if successful, nullptr otherwise.
  *
  * @see console::internal::check_quit(const std::string& input)
  * @see DB_API::check_file_exists(const std::string& filepath)
  * @see DB_API::read_db(const std::string& filepath)
  */
-std::shared_ptr<sqlite3> console::internal::get_db(std::string& db_path, std::string& err_msg)
+std::shared_ptr<CatalogDb> console::internal::get_db(std::string& db_path, std::string& err_msg)
 {
 	clear();
 	printw("\n");
@@ -96,7 +96,7 @@ std::shared_ptr<sqlite3> console::internal::get_db(std::string& db_path, std::st
 
 	} while (DB_API::check_file_exists(db_path) == false);
 
-	std::shared_ptr<sqlite3> db = DB_API::read_db(db_path);
+	std::shared_ptr<CatalogDb> db = DB_API::read_db(db_path);
 
 	if (db == nullptr)
 	{
@@ -255,9 +255,9 @@ int console::internal::yes_no(const std::string& str)
  * The user can enter "exit" at any prompt to cancel the card addition process.
  *
  * @see Card
- * @see DB_API::validate_issuer
- * @see DB_API::validate_length
- * @see DB_API::validate_prefix
+ * @see Card::validate_issuer
+ * @see Card::validate_length
+ * @see Card::validate_prefix
  * @see console::internal::check_quit
  */
 Card console::internal::add_card()
@@ -266,6 +266,7 @@ Card console::internal::add_card()
 	std::string issuer;
 	std::string length;
 	std::string prefixes;
+	Card::PrefixError prefix_error{};
 
 	printw("The issuer can be anything except an empty string\n");
 	printw("The length can be any positive number up to 32\n");
@@ -294,7 +295,7 @@ Card console::internal::add_card()
 
 			return ret && Card::validate_length(std::stoi(input));
 		},
-		[&prefixes, &length](const std::string& input) { return Card::validate_prefix(input, std::stoi(length)); }
+		[&length, &prefix_error](const std::string& input) { return Card::validate_prefix(input, std::stoi(length), &prefix_error); }
 	};
 
 	for (size_t i = 0; i < inputs.size(); ++i)
@@ -320,7 +321,14 @@ Card console::internal::add_card()
 				break;
 			}
 
-			printw("Illegal input");
+			if (i == 2)
+			{
+				printw("Illegal input: %s at position %zu", prefix_error.message, prefix_error.position + 1);
+			}
+			else
+			{
+				printw("Illegal input");
+			}
 			move(y, 0);          // move to beginning of line
 			clrtoeol();          // clear line
 		}
@@ -369,11 +377,12 @@ inline std::string console::internal::get_card_string(int max_length, const Card
  * of the displayed cards. It draws the cards on the console, with an option to highlight the selected row.
  *
  * @param cards_vec A vector of Card objects representing the cards to be displayed.
- * @param start_row The index of the first card to be displayed.
+ * @param rows The indexes of the cards in the list, e.g. the results of a search.
+ * @param start_row The position in rows of the first card to be displayed.
  * @param visible_rows The number of rows visible on the console for displaying cards.
  * @param max_offset The maximum length for padding each component of the Card when drawing.
- * @param curr_row_idx The index of the currently selected row (to be highlighted).
- * @param selected_rows A vector of boolean values indicating which rows are selected.
+ * @param curr_row_idx The position in rows of the currently selected row (to be highlighted).
+ * @param selected_rows A vector of boolean values indicating which cards are selected.
  *
  * The function uses the ncurses library to interact with the console screen.
  * It iterates over the specified range of cards and draws each card along with an optional selection indicator.
@@ -382,16 +391,16 @@ inline std::string console::internal::get_card_string(int max_length, const Card
  * @see Card
  * @see console::internal::get_card_string
  */
-void console::internal::draw_cards(const std::vector<Card>& cards_vec, int start_row, int visible_rows, int max_offset, int curr_row_idx, const std::vector<bool>& selected_rows)
+void console::internal::draw_cards(const std::vector<Card>& cards_vec, const std::vector<int>& rows, int start_row, int visible_rows, int max_offset, int curr_row_idx, const std::vector<bool>& selected_rows)
 {
 	int y_offset{ 3 };
 	int x_offset{ 5 };
 
 	// Draw buttons at the bottom of the screen
-	for (int i{ start_row }; i < start_row + visible_rows && i < cards_vec.size(); i++)
+	for (int i{ start_row }; i < start_row + visible_rows && i < rows.size(); i++)
 	{
-		mvprintw(i + y_offset - start_row, x_offset, get_card_string(max_offset, cards_vec[i]).c_str());
-		if (selected_rows[i])
+		mvprintw(i + y_offset - start_row, x_offset, get_card_string(max_offset, cards_vec[rows[i]]).c_str());
+		if (selected_rows[rows[i]])
 		{
 			mvprintw(i + y_offset - start_row, 0, "[X]");
 		}
@@ -401,10 +410,10 @@ void console::internal::draw_cards(const std::vector<Card>& cards_vec, int start
 		}
 	}
 
-	if (curr_row_idx < cards_vec.size())
+	if (curr_row_idx < rows.size())
 	{
 		attron(A_REVERSE);
-		mvprintw(curr_row_idx + y_offset - start_row, x_offset, get_card_string(max_offset, cards_vec[curr_row_idx]).c_str());
+		mvprintw(curr_row_idx + y_offset - start_row, x_offset, get_card_string(max_offset, cards_vec[rows[curr_row_idx]]).c_str());
 		attroff(A_REVERSE);
 	}
 }
@@ -415,6 +424,8 @@ void console::internal::draw_cards(const std::vector<Card>& cards_vec, int start
  * The function displays a list of cards, allowing the user to navigate, select, and perform various actions on them.
  * Actions include adding a new card, removing selected cards, editing a card, saving changes to the database, and more.
  * The user can navigate the list with arrow keys, select/deselect cards with the spacebar, and perform actions with the Enter key.
+ * '/' opens a search prompt that narrows the list with every key typed (see SearchIndex), Enter keeps the
+ * results and Escape clears the search. The index is built on the first search after the cards change.
  *
  * @param db A shared pointer to the SQLite database.
  * @param db_path The path to the SQLite database.
@@ -426,8 +437,9 @@ void console::internal::draw_cards(const std::vector<Card>& cards_vec, int start
  * @see console::internal::draw_cards
  * @see console::internal::add_card
  * @see DB_API::write_cards
+ * @see SearchIndex
  */
-int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::string& db_path, std::vector<Card>& cards_vec, std::vector<bool>& cards_selection)
+int console::internal::choose_cards(std::shared_ptr<CatalogDb> db, const std::string& db_path, std::vector<Card>& cards_vec, std::vector<bool>& cards_selection)
 {
 	int x_offset{ 5 };
 	int card_offset{ 25 };
@@ -441,6 +453,7 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 		console::Button("Edit", 5),
 		console::Button("Next", 1),
 		console::Button("Save", 6),
+		console::Button("Lint", 7),
 		console::Button("Exit", 2)
 	};
 
@@ -449,26 +462,109 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 	int start_row{};
 	int current_row{};
 
+	// the listed cards, the results of the search
+	SearchIndex search_index{};
+	bool indexed{ false };
+	bool searching{ false };
+	bool search_changed{ true };
+	std::string search{};
+	std::vector<int> rows{};
+
 	bool flag{ true };
 
 	while (flag)
 	{
+		if (search_changed)
+		{
+			SearchIndex::Query query{ search };
+			if (query.empty())
+			{
+				rows.resize(cards_vec.size());
+				std::iota(rows.begin(), rows.end(), 0);
+			}
+			else
+			{
+				if (indexed == false)
+				{
+					search_index.build(cards_vec);
+					indexed = true;
+				}
+				search_index.search(query, rows);
+			}
+			current_row = std::max(0, std::min(static_cast<int>(rows.size()) - 1, current_row));
+			start_row = std::min(start_row, current_row);
+			search_changed = false;
+		}
+
 		int window_h{}, window_w{};
 		getmaxyx(stdscr, window_h, window_w); // Get window size
-		int visible_rows = std::min(window_h - 6, static_cast<int>(cards_vec.size())); // Calculate the number of visible rows
+		int visible_rows = std::min(window_h - 6, static_cast<int>(rows.size())); // Calculate the number of visible rows
 		clear();
 
-		printw("Scroll the list with up/down arrow keys, select with space.\n");
+		printw("Scroll the list with up/down arrow keys, select with space, search with /.\n");
 		printw("Use left/right arrow keys for buttons, confirm with enter.\n");
 		mvprintw(2, x_offset, "Issuer");
 		mvprintw(2, x_offset + card_offset, "Length");
 		mvprintw(2, x_offset + card_offset * 2, "Prefixes");
 
-		draw_cards(cards_vec, start_row, visible_rows, card_offset, current_row, cards_selection);
+		draw_cards(cards_vec, rows, start_row, visible_rows, card_offset, current_row, cards_selection);
 		draw_buttons(buttons, curr_btn_idx); // Draw buttons at the bottom of the screen
 		mvprintw(window_h - 2, 0, err_msg.c_str());
+		if (searching || search.empty() == false)
+		{
+			mvprintw(window_h - 3, 0, "Search: %s", search.c_str());
+			printw("%s", searching ? "_" : "");
+			printw("   (%zu of %zu)", rows.size(), cards_vec.size());
+		}
 		refresh();
 		int ch = getch(); // Get user input
+
+		// while the prompt is open the keys edit the search, the list keys still work
+		if (searching)
+		{
+			bool edited{ true };
+			if (ch == 27)	// escape
+			{
+				search.clear();
+				searching = false;
+			}
+			else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8)
+			{
+				if (search.empty() == false)
+				{
+					search.pop_back();
+				}
+			}
+#if defined(_WIN64) || defined(_WIN32)
+			else if (ch == 13 || ch == PADENTER)
+#else
+			else if (ch == 10)
+#endif
+			{
+				searching = false;
+				edited = false;
+			}
+			else if (ch >= 32 && ch < 127)
+			{
+				search += static_cast<char>(ch);
+			}
+			else
+			{
+				edited = false;
+			}
+
+			if (edited)
+			{
+				search_changed = true;
+				current_row = 0;
+				start_row = 0;
+			}
+			if (edited || searching == false)
+			{
+				continue;
+			}
+		}
+
 		switch (ch)
 		{
 			// list scrolling
@@ -477,7 +573,7 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 			start_row = std::min(current_row, start_row);
 			break;
 		case KEY_DOWN:
-			current_row = std::min(current_row + 1, std::max(0, static_cast<int>(cards_vec.size()) - 1));
+			current_row = std::min(current_row + 1, std::max(0, static_cast<int>(rows.size()) - 1));
 			start_row = std::max(start_row, current_row - visible_rows + 1);
 			break;
 		case KEY_PPAGE:
@@ -485,7 +581,7 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 			start_row = std::min(current_row, start_row);
 			break;
 		case KEY_NPAGE:
-			current_row = std::min(std::max(0, static_cast<int>(cards_vec.size()) - 1), current_row + visible_rows);
+			current_row = std::min(std::max(0, static_cast<int>(rows.size()) - 1), current_row + visible_rows);
 			start_row = std::max(start_row, current_row - visible_rows + 1);
 			break;
 		case KEY_HOME:
@@ -493,11 +589,17 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 			start_row = 0;
 			break;
 		case KEY_END:
-			current_row = std::max(static_cast<int>(cards_vec.size()) - 1, 0);
+			current_row = std::max(static_cast<int>(rows.size()) - 1, 0);
 			start_row = std::max(start_row, current_row - visible_rows + 1);
 			break;
 		case ' ':
-			cards_selection[current_row] = !cards_selection[current_row];
+			if (static_cast<size_t>(current_row) < rows.size())
+			{
+				cards_selection[rows[current_row]] = !cards_selection[rows[current_row]];
+			}
+			break;
+		case '/':
+			searching = true;
 			break;
 
 			// button scrolling
@@ -538,22 +640,25 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 				{
 					cards_vec.push_back(new_card);
 					cards_selection.push_back(false);
+					indexed = false;
+					search_changed = true;
 				}
 			}
 			break;
 			case 4:	// remove
-				if (cards_vec.empty())
+				if (static_cast<size_t>(current_row) >= rows.size())
 				{
 					break;
 				}
-				cards_vec.erase(std::next(cards_vec.begin(), current_row), std::next(cards_vec.begin(), current_row + 1));
-				cards_selection.erase(std::next(cards_selection.begin(), current_row), std::next(cards_selection.begin(), current_row + 1));
+				cards_vec.erase(std::next(cards_vec.begin(), rows[current_row]), std::next(cards_vec.begin(), rows[current_row] + 1));
+				cards_selection.erase(std::next(cards_selection.begin(), rows[current_row]), std::next(cards_selection.begin(), rows[current_row] + 1));
 				start_row = std::max(0, start_row - 1);
-				current_row = std::max(0, std::min(static_cast<int>(cards_vec.size()) - 1, current_row));
+				indexed = false;
+				search_changed = true;
 				break;
 			case 5:	// edit
 			{
-				if (cards_vec.empty())
+				if (static_cast<size_t>(current_row) >= rows.size())
 				{
 					break;
 				}
@@ -562,13 +667,15 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 				mvprintw(1, x_offset, "Issuer");
 				mvprintw(1, x_offset + card_offset, "Length");
 				mvprintw(1, x_offset + card_offset * 2, "Prefixes\n");
-				mvprintw(2, x_offset, get_card_string(card_offset, cards_vec[current_row]).c_str());
+				mvprintw(2, x_offset, get_card_string(card_offset, cards_vec[rows[current_row]]).c_str());
 
 				printw("\n\n");
 				Card new_card = add_card();
 				if (new_card.empty() == false)
 				{
-					cards_vec[current_row] = new_card;
+					cards_vec[rows[current_row]] = new_card;
+					indexed = false;
+					search_changed = true;
 				}
 			}
 			break;
@@ -578,6 +685,14 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 					err_msg = "Saved";
 				}
 				break;
+			case 7:	// lint
+				if (lint_cards(cards_vec))
+				{
+					err_msg = "Merged the ranges, save to keep them";
+					indexed = false;
+					search_changed = true;
+				}
+				break;
 			default:
 				break;
 			}
@@ -593,13 +708,112 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
 }
 
 /**
- * @brief Allows the user to choose the amount of cards to generate.
+ * @brief Shows the findings of the catalog linter.
+ *
+ * The findings are listed one per line and can be scrolled with the arrow keys. "Merge"
+ * merges the duplicate, shadowed, overlapping and adjacent ranges of every card and lints
+ * the result again, the merged cards are saved with the catalog's "Save" button.
+ *
+ * @param cards_vec The cards of the catalog.
+ * @return True if the ranges were merged, false otherwise.
+ *
+ * @see Linter::lint
+ * @see Linter::merge
+ */
+bool console::internal::lint_cards(std::vector<Card>& cards_vec)
+{
+	std::vector<console::Button> buttons{
+		console::Button("Back", 0),
+		console::Button("Merge", 1)
+	};
+
+	std::vector<Linter::Finding> findings{ Linter::lint(cards_vec) };
+	std::string status{};
+	bool merged{ false };
+	int curr_btn_idx{};
+	int start_row{};
+	bool flag{ true };
+
+	while (flag)
+	{
+		int window_h{}, window_w{};
+		getmaxyx(stdscr, window_h, window_w); // Get window size
+		int visible_rows{ std::max(1, window_h - 6) };
+		clear();
+
+		printw("Scroll the findings with up/down arrow keys.\n");
+		printw("Use left/right arrow keys for buttons, confirm with enter.\n");
+		mvprintw(2, 0, "%zu findings in %zu cards", findings.size(), cards_vec.size());
+		for (int i{}; i < visible_rows && start_row + i < static_cast<int>(findings.size()); i++)
+		{
+			mvprintw(3 + i, 2, "%s", Linter::describe(cards_vec, findings[start_row + i]).c_str());
+		}
+		draw_buttons(buttons, curr_btn_idx); // Draw buttons at the bottom of the screen
+		mvprintw(window_h - 2, 0, "%s", status.c_str());
+		refresh();
+
+		int max_start{ std::max(0, static_cast<int>(findings.size()) - visible_rows) };
+		int ch = getch(); // Get user input
+		switch (ch)
+		{
+		case KEY_UP:
+			start_row = std::max(0, start_row - 1);
+			break;
+		case KEY_DOWN:
+			start_row = std::min(max_start, start_row + 1);
+			break;
+		case KEY_PPAGE:
+			start_row = std::max(0, start_row - visible_rows);
+			break;
+		case KEY_NPAGE:
+			start_row = std::min(max_start, start_row + visible_rows);
+			break;
+		case KEY_LEFT:
+			curr_btn_idx = (curr_btn_idx - 1 + static_cast<int>(buttons.size())) % static_cast<int>(buttons.size());
+			break;
+		case KEY_RIGHT:
+			curr_btn_idx = (curr_btn_idx + 1) % static_cast<int>(buttons.size());
+			break;
+
+#if defined(_WIN64) || defined(_WIN32)
+		case 13:
+		case PADENTER:
+#else
+		case 10:
+#endif
+			if (buttons[curr_btn_idx].m_action == 0)	// back
+			{
+				flag = false;
+				break;
+			}
+			// merge
+			{
+				size_t removed{ Linter::merge(cards_vec) };
+				findings = Linter::lint(cards_vec);
+				start_row = 0;
+				merged = true;
+				status = "Removed " + std::to_string(removed) + " ranges";
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return merged;
+}
+
+/**
+ * @brief Allows the user to choose when the generation stops.
  *
+ * The generation stops after an amount of cards, when the output reaches a size or after
+ * a time budget, Tab switches between them and 'u' switches the unit of a size or a time.
  * The function displays the estimated time and size based on the chosen amount and allows the user
  * to adjust the amount using arrow keys, enter, or numeric input.
  * The user can navigate buttons for back, next, and exit.
  *
- * @param amount Reference to the DATATYPE variable representing the chosen amount.
+ * @param stop Reference to the stop condition, its value is in cards, bytes or seconds.
  * @return The index of the selected action (button) when the user exits the amount selection interface.
  *
  * @tparam DATATYPE The data type used for representing the chosen amount.
@@ -608,7 +822,7 @@ int console::internal::choose_cards(std::shared_ptr<sqlite3> db, const std::stri
  * @see File::estimate_size
  * @see File::format_time
  */
-int console::internal::choose_amount(DATATYPE& amount)
+int console::internal::choose_amount(File::StopCondition& stop)
 {
 	std::vector<console::Button> buttons{
 		console::Button("Back", 0),
@@ -616,10 +830,30 @@ int console::internal::choose_amount(DATATYPE& amount)
 		console::Button("Exit", 2)
 	};
 
+	static const std::vector<std::pair<const char*, unsigned long long>> size_units{ { "B", 1ULL }, { "KB", 1ULL << 10 }, { "MB", 1ULL << 20 }, { "GB", 1ULL << 30 }, { "TB", 1ULL << 40 } };
+	static const std::vector<std::pair<const char*, unsigned long long>> time_units{ { "seconds", 1 }, { "minutes", 60 }, { "hours", 3600 } };
+	static size_t size_unit{ 3 };
+	static size_t time_unit{ 1 };
+
 	auto est_duration = File::estimate_time< std::chrono::nanoseconds>();
 	static constexpr DATATYPE min_amount{ 1 };
 	static constexpr DATATYPE max_amount{ std::numeric_limits<DATATYPE>::max() / 2 };
 
+	// the unit the amount is entered in
+	auto unit = [&]()
+	{
+		switch (stop.mode)
+		{
+		case File::StopMode::bytes:
+			return size_units[size_unit];
+		case File::StopMode::time:
+			return time_units[time_unit];
+		default:
+			return std::pair<const char*, unsigned long long>{ "cards", 1 };
+		}
+	};
+	DATATYPE amount{ static_cast<DATATYPE>(std::min<unsigned long long>(stop.value / unit().second, max_amount)) };
+
 	int curr_btn_idx{};
 	int selected_action{};
 	bool flag{ true };
@@ -627,16 +861,30 @@ int console::internal::choose_amount(DATATYPE& amount)
 
 	while (flag)
 	{
+		stop.value = amount > File::unlimited / unit().second ? File::unlimited : amount * unit().second;
+		unsigned long long est_cards{ stop.value };
+		if (stop.mode == File::StopMode::bytes)
+		{
+			est_cards = stop.value / File::typical_record_bytes;
+		}
+		else if (stop.mode == File::StopMode::time)
+		{
+			est_cards = static_cast<unsigned long long>(std::chrono::seconds(stop.value) / std::max(est_duration, std::chrono::nanoseconds(1)));
+		}
+
 		clear();
-		std::string f_time{ File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(est_duration * amount)) };
-		std::string size_str{ File::estimate_size(amount) };
-		f_time = File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(est_duration * amount));
-		size_str = File::estimate_size(amount);
-		printw("Choose how many cards to generate\n");
-		printw("Use left/right arrow keys for buttons, confirm with enter.\n\n");
+		std::string f_time{ File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(est_duration * est_cards)) };
+		std::string size_str{ File::estimate_size(est_cards) };
+		if (stop.mode == File::StopMode::time)
+		{
+			f_time = File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::seconds(stop.value));
+		}
+		printw("Choose when to stop generating: after a number of cards, at a file size or after a time\n");
+		printw("Use left/right arrow keys for buttons, confirm with enter. Tab changes the stop condition, 'u' the unit.\n\n");
+		printw("Estimated cards: %s\n", std::to_string(est_cards).c_str());
 		printw("Estimated time: %s\n", f_time.c_str());
 		printw("Estimated size: %s\n", size_str.c_str());
-		printw("Amount: %s", std::to_string(amount).c_str());
+		printw("Stop after: %s %s", std::to_string(amount).c_str(), unit().first);
 
 		draw_buttons(buttons, curr_btn_idx); // Draw buttons at the bottom of the screen
 		refresh();
@@ -651,6 +899,22 @@ int console::internal::choose_amount(DATATYPE& amount)
 			curr_btn_idx = (curr_btn_idx + 1) % static_cast<int>(buttons.size());
 			break;
 
+			// stop condition and unit
+		case '\t':
+			stop.mode = stop.mode == File::StopMode::cards ? File::StopMode::bytes : stop.mode == File::StopMode::bytes ? File::StopMode::time : File::StopMode::cards;
+			break;
+		case 'u':
+		case 'U':
+			if (stop.mode == File::StopMode::bytes)
+			{
+				size_unit = (size_unit + 1) % size_units.size();
+			}
+			else if (stop.mode == File::StopMode::time)
+			{
+				time_unit = (time_unit + 1) % time_units.size();
+			}
+			break;
+
 #if defined(_WIN64) || defined(_WIN32)
 		case 13:
 		case PADENTER:
@@ -861,25 +1125,213 @@ int console::internal::choose_file(std::string& exp_path)
 	return selected_action;
 }
 
+/**
+ * @brief Groups the selected cards by issuer.
+ *
+ * @param cards_vec The catalog of the export.
+ * @param cards_selection The selected cards.
+ * @param stop The stop condition of the export, for the ETA.
+ */
+console::ExportStats::ExportStats(const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, const File::StopCondition& stop) : m_stop{ stop }, m_catalog_size{ cards_vec.size() }
+{
+	std::unordered_map<std::string, int> ids{};
+	for (size_t i{}; i < cards_vec.size() && i < cards_selection.size(); i++)
+	{
+		if (cards_selection[i])
+		{
+			auto it = ids.emplace(cards_vec[i].get_issuer(), static_cast<int>(m_issuers.size()));
+			if (it.second)
+			{
+				m_issuers.push_back(cards_vec[i].get_issuer());
+			}
+			m_cards.emplace_back(i, it.first->second);
+		}
+	}
+	m_issuer_counts.assign(m_issuers.size(), 0);
+	m_order.resize(m_issuers.size());
+	std::iota(m_order.begin(), m_order.end(), 0);
+}
+
+/**
+ * @brief Resets the statistics and creates the metrics of a new export.
+ *
+ * @return The metrics to set in the options of the export, they count the cards of every catalog card.
+ */
+std::shared_ptr<Metrics> console::ExportStats::start()
+{
+	m_metrics = std::make_shared<Metrics>(m_catalog_size);
+	m_last = Metrics::Sample{};
+	m_samples = 0;
+	m_cards_rate = 0.0;
+	m_bytes_rate = 0.0;
+	m_shares.fill(0.0);
+	std::fill(m_issuer_counts.begin(), m_issuer_counts.end(), 0);
+	return m_metrics;
+}
+
+/**
+ * @brief Pops the samples of the export and updates the rates and the issuer counts.
+ *
+ * The rates are averaged over about smoothing_seconds, weighting every interval by its length,
+ * so the ETA follows a change of speed without jumping with every batch. The issuer counts
+ * are only added up again when a sample arrived.
+ */
+void console::ExportStats::update()
+{
+	Metrics::Sample sample{};
+	bool changed{};
+	while (m_metrics != nullptr && m_metrics->pop(sample))
+	{
+		double interval{ sample.seconds - m_last.seconds };
+		if (m_samples++ > 0 && interval > 0.0)
+		{
+			double cards_rate{ (sample.cards - m_last.cards) / interval };
+			double bytes_rate{ (sample.bytes - m_last.bytes) / interval };
+			double weight{ m_samples == 2 ? 1.0 : 1.0 - std::exp(-interval / smoothing_seconds) };
+			m_cards_rate += weight * (cards_rate - m_cards_rate);
+			m_bytes_rate += weight * (bytes_rate - m_bytes_rate);
+			m_shares = { (sample.generate_seconds - m_last.generate_seconds) / interval * 100.0,
+				(sample.write_seconds - m_last.write_seconds) / interval * 100.0,
+				(sample.wait_seconds - m_last.wait_seconds) / interval * 100.0 };
+		}
+		m_last = sample;
+		changed = true;
+	}
+	if (changed == false)
+	{
+		return;
+	}
+
+	std::fill(m_issuer_counts.begin(), m_issuer_counts.end(), 0);
+	for (const std::pair<size_t, int>& card : m_cards)
+	{
+		m_issuer_counts[card.second] += m_metrics->card_count(card.first);
+	}
+	std::stable_sort(m_order.begin(), m_order.end(), [this](int a, int b) { return m_issuer_counts[a] > m_issuer_counts[b]; });
+}
+
+/**
+ * @brief Returns the seconds left until the stop condition is met.
+ *
+ * A count or a size is divided by the smoothed rate, a time budget is what the progress leaves of it.
+ */
+double console::ExportStats::eta() const
+{
+	switch (m_stop.mode)
+	{
+	case File::StopMode::bytes:
+		return m_bytes_rate > 0.0 ? std::max(0.0, (static_cast<double>(m_stop.value) - m_last.bytes) / m_bytes_rate) : -1.0;
+	case File::StopMode::time:
+		return m_stop.value * (1.0 - g_progress);
+	default:
+		return m_cards_rate > 0.0 ? std::max(0.0, (static_cast<double>(m_stop.value) - m_last.cards) / m_cards_rate) : -1.0;
+	}
+}
+
+/**
+ * @brief Draws the statistics of the export.
+ *
+ * Every row is written over and cleared to its end instead of clearing the screen, so
+ * refresh() only sends the cells that changed and a redraw costs the same on a slow terminal
+ * no matter how long the export runs. The issuers fill the rows left, most cards first.
+ *
+ * @param top The first row.
+ * @param bottom The row after the last one.
+ * @param width The width of the window, longer rows are cut.
+ */
+void console::ExportStats::draw(int top, int bottom, int width) const
+{
+	int row{ top };
+	auto line = [&](const std::string& text)
+	{
+		if (row < bottom)
+		{
+			mvaddnstr(row, 0, text.c_str(), std::max(width - 1, 0));
+			clrtoeol();
+		}
+		row++;
+	};
+	auto format_seconds = [](double seconds)
+	{
+		return File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds)));
+	};
+
+	if (m_samples == 0)
+	{
+		line(m_metrics == nullptr ? "Press Start to begin." : "Starting...");
+		while (row < bottom)
+		{
+			line("");
+		}
+		return;
+	}
+
+	std::ostringstream stream{};
+	stream << std::fixed << std::setprecision(0);
+	double eta_seconds{ g_started ? eta() : 0.0 };
+	stream << "Elapsed: " << format_seconds(m_last.seconds) << "    ETA: " << (eta_seconds < 0.0 ? std::string("--") : format_seconds(eta_seconds));
+	line(stream.str());
+
+	stream.str("");
+	stream << "Cards:   " << m_last.cards << "    " << m_cards_rate << " cards/s";
+	line(stream.str());
+
+	stream.str("");
+	stream << "Written: " << File::format_size(static_cast<double>(m_last.bytes)) << "    " << std::setprecision(2) << m_bytes_rate / 1e6 << " MB/s";
+	line(stream.str());
+
+	stream.str("");
+	stream << "Memory:  " << File::format_size(static_cast<double>(m_last.resident_bytes));
+	line(stream.str());
+
+	stream.str("");
+	stream << std::setprecision(0) << "Worker:  " << Metrics::stage_name(m_metrics->stage()) << " (generating " << m_shares[0] << "%, writing " << m_shares[1] << "%, waiting " << m_shares[2] << "%)";
+	line(stream.str());
+
+	// the counts are read after the sample, so they are shared out of their own total
+	unsigned long long counted{ std::accumulate(m_issuer_counts.begin(), m_issuer_counts.end(), 0ULL) };
+	line("");
+	line("Issuer                          Cards        Share");
+	for (int issuer : m_order)
+	{
+		if (row >= bottom)
+		{
+			break;
+		}
+		char text[128]{};
+		std::snprintf(text, sizeof(text), "%-30.30s  %-11llu  %5.1f%%", m_issuers[issuer].c_str(), m_issuer_counts[issuer],
+			counted > 0 ? 100.0 * m_issuer_counts[issuer] / counted : 0.0);
+		line(text);
+	}
+	while (row < bottom)
+	{
+		line("");
+	}
+}
+
 /**
  * @brief Initiates and manages the generation of data and exporting to a file.
  *
  * This function presents a user interface for controlling the generation and exporting of data.
  * It allows the user to start, pause, stop, go back, or exit the data generation process.
- * The progress is displayed on the screen.
+ * The progress is displayed on the screen with the live statistics of the export (see ExportStats).
+ * The report of an export goes next to a regular file, one that couldn't be written is shown
+ * under the progress bar.
+ *
+ * The screen is only cleared when a key was pressed, the periodic redraws overwrite the rows
+ * in place so curses sends just the cells that changed.
  *
  * @param exp_path The file path for exporting the generated data.
  * @param cards_vec A vector of Card objects representing the available cards.
  * @param cards_selection A vector of boolean values indicating which cards are selected.
- * @param amount The amount of data to generate.
+ * @param stop When to stop generating.
  * @return The index of the selected action (button) when the user exits the generation interface.
  *
  * @tparam DATATYPE The data type used for representing the amount of data to generate.
  * @see File::export_cards
  */
-int console::internal::generate(const std::string& exp_path, const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, DATATYPE amount)
+int console::internal::generate(const std::string& exp_path, const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, const File::StopCondition& stop)
 {
-	static std::ofstream output_file;
 	bool flag{ true };
 
 	std::vector<console::Button> buttons{
@@ -891,26 +1343,47 @@ int console::internal::generate(const std::string& exp_path, const std::vector<C
 
 	int curr_btn_idx{};
 	int selected_action{};
+	console::ExportStats stats{ cards_vec, cards_selection, stop };
+	std::string report_path{};
+	std::shared_ptr<std::atomic<bool>> report_failed{ std::make_shared<std::atomic<bool>>(false) };	// Set by the export thread, which may outlive this screen.
+	bool redraw_all{ true };
 	timeout(250); // Set a timeout of 250 milliseconds (0.25 seconds) for getch()
 
 	while (flag)
 	{
 		int window_h{}, window_w{};
 		getmaxyx(stdscr, window_h, window_w); // Get window size
-		clear();
-		printw("Use left/right arrow keys for buttons, confirm with enter.\n");
+		if (redraw_all)
+		{
+			// after a key, a prompt or a resize, the periodic redraws below don't clear the screen
+			erase();
+			printw("Use left/right arrow keys for buttons, confirm with enter.\n");
+			redraw_all = false;
+		}
 		if (g_started == false && buttons[1].m_label[0] != 'S')
 		{
 			buttons[1].m_label = "Start";
 		}
+		move(window_h - 1, 0);
+		clrtoeol();
 		draw_buttons(buttons, curr_btn_idx); // Draw buttons at the bottom of the screen
 
+		stats.update();
+		stats.draw(2, window_h - 4, window_w);
+
 		const int width = window_w / 2;
     	const int bar_width = static_cast<int>(g_progress * width);
 		std::stringstream prog_stream;
 		prog_stream << "[" << std::string(bar_width, '#') << std::string(width - bar_width, ' ') << "] " << std::fixed << std::setprecision(0) << (g_progress * 100) << "%%";
 
 		mvprintw(window_h - 3, 0, prog_stream.str().c_str());
+		clrtoeol();
+		move(window_h - 2, 0);
+		if (*report_failed)
+		{
+			printw("Couldn't write the report \"%s\"", report_path.c_str());
+		}
+		clrtoeol();
 		refresh();
 
 		int ch = getch(); // Get user input
@@ -919,6 +1392,7 @@ int console::internal::generate(const std::string& exp_path, const std::vector<C
 		{
 			continue;
 		}
+		redraw_all = true;
 
 		switch (ch)
 		{
@@ -943,9 +1417,21 @@ int console::internal::generate(const std::string& exp_path, const std::vector<C
 			case 1:	// Start/Resume/Pause
 				if (g_started == false)
 				{
-					output_file.open(exp_path.c_str(), std::ios::trunc);
+					std::shared_ptr<const Catalog> catalog{ Catalog::compile(cards_vec) };
+					std::unique_ptr<Sink> sink{};
+					if (SqliteSink::is_database_path(exp_path))
+					{
+						SqliteSink::Options table_options{};
+						table_options.issuer_columns = true;
+						std::string err_msg{};
+						sink = SqliteSink::open(exp_path, catalog, table_options, err_msg);
+					}
+					else if (std::FILE* output_file{ std::fopen(exp_path.c_str(), "wb") })
+					{
+						sink.reset(new FileSink(output_file));
+					}
 
-					if (output_file.is_open() == false)
+					if (sink == nullptr)
 					{
 						std::string msg = "Couldn't open file, would you like to choose another file?";
 						if (yes_no(msg))
@@ -958,7 +1444,18 @@ int console::internal::generate(const std::string& exp_path, const std::vector<C
 					g_started = true;
 					g_paused = true;
 					g_progress = 0.0f;
-					std::thread write_thread(&File::export_cards<DATATYPE>, std::ref(output_file), cards_vec, cards_selection, amount);
+					File::ExportOptions options{};
+					options.seed = File::random_seed();
+					options.metrics = stats.start();
+					report_path = File::default_report_path(exp_path);
+					*report_failed = false;
+					options.report_path = report_path;
+					options.finished = [report_failed, report = report_path.empty() == false](const File::ExportResult& result)
+					{
+						*report_failed = report && result.report_written == false;
+					};
+					unsigned long long amount{ File::apply_stop(stop, options) };
+					std::thread write_thread(&File::export_cards<unsigned long long>, std::move(sink), catalog, cards_selection, amount, options);
 					write_thread.detach();
 				}
 				g_paused = !g_paused;
@@ -1053,8 +1550,8 @@ void console::run(const std::string& version, const std::string& url, const std:
 	int step{};
 	int choice{};
 	std::string db_path{};
-	std::shared_ptr<sqlite3> db;
-	DATATYPE amount{ 1 };
+	std::shared_ptr<CatalogDb> db;
+	File::StopCondition stop{};
 	std::string exp_path{ "cards_output.txt" };
 	std::string err_msg{};
 	std::vector<Card> cards_vec{};
@@ -1086,13 +1583,13 @@ void console::run(const std::string& version, const std::string& url, const std:
 			choice = console::internal::choose_cards(db, db_path, cards_vec, cards_selection);
 			break;
 		case 2:	// choose amount and display estimation
-			choice = console::internal::choose_amount(amount);
+			choice = console::internal::choose_amount(stop);
 			break;
 		case 3:	// choose output file
 			choice = console::internal::choose_file(exp_path);
 			break;
 		case 4:
-			choice = console::internal::generate(exp_path, cards_vec, cards_selection, amount);
+			choice = console::internal::generate(exp_path, cards_vec, cards_selection, stop);
 			break;
 		default:
 			break;
@@ -1,11 +1,17 @@
 #pragma once
 #include "DB_API.h"
+#include "Linter.h"
+#include "SqliteSink.h"
+#include "SearchIndex.h"
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <functional>
+#include <numeric>
+#include <unordered_map>
+#include <cmath>
 
 #if defined(_WIN64) || defined(_WIN32)
 #define NOMINMAX
@@ -32,6 +38,9 @@ namespace console
 {
 	void run(const std::string& version, const std::string& url, const std::string& license);
 
+	// Runs a non-interactive export described by the command-line arguments and returns the exit code.
+	int batch(int argc, char* argv[]);
+
 	// Represents a button with a label and associated action.
 	class Button
 	{
@@ -41,6 +50,42 @@ namespace console
 		int m_action;
 	};
 
+	// The live statistics of an export, shown by the progress view of internal::generate.
+	class ExportStats
+	{
+	public:
+		ExportStats(const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, const File::StopCondition& stop);
+
+		// Starts following a new export, returns the metrics to pass in its options.
+		std::shared_ptr<Metrics> start();
+
+		// Takes the samples pushed by the export since the previous call.
+		void update();
+
+		// Draws the statistics on rows top to bottom (exclusive), writing only the cells that change.
+		void draw(int top, int bottom, int width) const;
+
+	private:
+		// Seconds left by the stop condition and the measured rates, negative while unknown.
+		double eta() const;
+
+		static constexpr double smoothing_seconds{ 3.0 };	// Time constant of the rates the ETA uses.
+
+		File::StopCondition m_stop{};
+		size_t m_catalog_size{};
+		std::vector<std::string> m_issuers{};				// Issuers of the selected cards.
+		std::vector<std::pair<size_t, int>> m_cards{};		// Selected cards and their issuer.
+		std::vector<unsigned long long> m_issuer_counts{};	// Cards written of every issuer.
+		std::vector<int> m_order{};							// Issuers by cards written, descending.
+
+		std::shared_ptr<Metrics> m_metrics{};
+		Metrics::Sample m_last{};
+		size_t m_samples{};
+		double m_cards_rate{};								// Smoothed rates.
+		double m_bytes_rate{};
+		std::array<double, 3> m_shares{};					// Percent of the last interval spent generating, writing and waiting.
+	};
+
 	// Internal utility functions for the console application.
 	class internal
 	{
@@ -56,7 +101,7 @@ namespace console
 		static bool check_quit(const std::string& input);
 
 		// Gets a SQLite database and returns it along with potential error messages.
-		static std::shared_ptr<sqlite3> get_db(std::string& db_path, std::string& err_msg);
+		static std::shared_ptr<CatalogDb> get_db(std::string& db_path, std::string& err_msg);
 
 		// Draws buttons on the console.
 		static void draw_buttons(const std::vector<console::Button>& buttons, size_t curr_btn_idx);
@@ -70,14 +115,17 @@ namespace console
 		// Gets a formatted string representation of a card.
 		static inline std::string get_card_string(int max_length, const Card& card);
 
-		// Draws a list of cards on the console.
-		static void draw_cards(const std::vector<Card>& cards_vec, int start_row, int visible_rows, int max_offset, int curr_row_idx, const std::vector<bool>& selected_rows);
+		// Draws a list of cards on the console, rows are the indexes of the cards to list.
+		static void draw_cards(const std::vector<Card>& cards_vec, const std::vector<int>& rows, int start_row, int visible_rows, int max_offset, int curr_row_idx, const std::vector<bool>& selected_rows);
 
 		// Guides the user in choosing cards and returns the user's action.
-		static int choose_cards(std::shared_ptr<sqlite3> db, const std::string& db_path, std::vector<Card>& cards_vec, std::vector<bool>& cards_selection);
+		static int choose_cards(std::shared_ptr<CatalogDb> db, const std::string& db_path, std::vector<Card>& cards_vec, std::vector<bool>& cards_selection);
+
+		// Shows the findings of the catalog linter and lets the user merge the ranges, returns true if the cards changed.
+		static bool lint_cards(std::vector<Card>& cards_vec);
 
-		// Guides the user in choosing the amount of data to generate and returns the user's action.
-		static int choose_amount(DATATYPE& amount);
+		// Guides the user in choosing when to stop generating and returns the user's action.
+		static int choose_amount(File::StopCondition& stop);
 
 		// Gets a valid file path from the user.
 		static void get_path(std::string& path);
@@ -86,7 +134,7 @@ namespace console
 		static int choose_file(std::string& exp_path);
 
 		// Guides the user in generating data and returns the user's action.
-		static int generate(const std::string& exp_path, const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, DATATYPE amount);
+		static int generate(const std::string& exp_path, const std::vector<Card>& cards_vec, const std::vector<bool>& cards_selection, const File::StopCondition& stop);
 
 		internal() = delete;
 	};
@@ -0,0 +1,883 @@
+#include "Daemon.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile std::sig_atomic_t s_stop{ 0 };
+
+/**
+ * @brief Signal handler that asks the event loop to shut down.
+ */
+static void handle_stop_signal(int)
+{
+	s_stop = 1;
+}
+
+/**
+ * @brief Checks if two strings are equal in a case-insensitive manner.
+ */
+static bool case_insensitive_equals(std::string_view a, std::string_view b)
+{
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+		[](char x, char y)
+		{
+			return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+		}
+	);
+}
+
+/**
+ * @brief Closes the epoll instance, the listeners, every client and removes the socket file.
+ */
+server::Daemon::~Daemon()
+{
+	for (const auto& client : m_clients)
+	{
+		close(client.first);
+	}
+	if (m_listen_fd != -1)
+	{
+		close(m_listen_fd);
+		unlink(m_socket_path.c_str());
+	}
+	if (m_http_fd != -1)
+	{
+		close(m_http_fd);
+	}
+	if (m_spare_fd != -1)
+	{
+		close(m_spare_fd);
+	}
+	if (m_epoll_fd != -1)
+	{
+		close(m_epoll_fd);
+	}
+}
+
+/**
+ * @brief Decodes a percent-encoded request value.
+ *
+ * "%XX" sequences are replaced by the byte they encode and '+' is replaced by a space,
+ * which lets issuer names containing spaces or separators be sent in a request line.
+ * Malformed escapes are copied through unchanged.
+ *
+ * @param str The encoded value.
+ * @return The decoded value.
+ */
+std::string server::Daemon::url_decode(const std::string& str)
+{
+	std::string decoded{};
+	decoded.reserve(str.size());
+
+	for (size_t i{}; i < str.size(); i++)
+	{
+		if (str[i] == '+')
+		{
+			decoded += ' ';
+		}
+		else if (str[i] == '%' && i + 2 < str.size() && std::isxdigit(static_cast<unsigned char>(str[i + 1])) && std::isxdigit(static_cast<unsigned char>(str[i + 2])))
+		{
+			decoded += static_cast<char>(std::stoi(str.substr(i + 1, 2), nullptr, 16));
+			i += 2;
+		}
+		else
+		{
+			decoded += str[i];
+		}
+	}
+	return decoded;
+}
+
+/**
+ * @brief Parses a generation request.
+ *
+ * The request is a list of '&' separated key=value pairs:
+ *  - issuer: comma-separated issuer names (case-insensitive), may be repeated, omitted means all issuers.
+ *    An empty or blank name rejects the request.
+ *  - count: the number of cards to generate (required).
+ *  - format: "plain" (default), "csv" or "json".
+ *  - seed: an unsigned integer, makes the stream reproducible.
+ *
+ * @param line The request line without its line terminator.
+ * @param request Receives the parsed request.
+ * @param err_msg Receives a description of the problem if the request is rejected.
+ * @return True if the request is valid, false otherwise.
+ */
+bool server::Daemon::parse_request(const std::string& line, Request& request, std::string& err_msg)
+{
+	bool has_count{ false };
+	std::istringstream iss(line);
+	std::string pair{};
+
+	while (std::getline(iss, pair, '&'))
+	{
+		if (pair.empty())
+		{
+			continue;
+		}
+
+		size_t eq{ pair.find('=') };
+		std::string key{ pair.substr(0, eq) };
+		std::string value{ eq == std::string::npos ? "" : url_decode(pair.substr(eq + 1)) };
+
+		if (key == "issuer")
+		{
+			// a blank name must not fall back to every issuer
+			std::istringstream issuers(value);
+			std::string issuer{};
+			size_t before{ request.issuers.size() };
+			while (std::getline(issuers, issuer, ','))
+			{
+				if (Card::validate_issuer(issuer) == false)
+				{
+					err_msg = "invalid issuer";
+					return false;
+				}
+				request.issuers.push_back(issuer);
+			}
+			if (request.issuers.size() == before)
+			{
+				err_msg = "invalid issuer";
+				return false;
+			}
+		}
+		else if (key == "count" || key == "seed")
+		{
+			if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.size() > 19)
+			{
+				err_msg = "invalid " + key;
+				return false;
+			}
+			unsigned long long number{ std::stoull(value) };
+			if (key == "count")
+			{
+				request.count = number;
+				has_count = true;
+			}
+			else
+			{
+				request.seed = number;
+				request.has_seed = true;
+			}
+		}
+		else if (key == "format")
+		{
+			if (File::parse_format(value, request.format) == false)
+			{
+				err_msg = "unknown format";
+				return false;
+			}
+		}
+		else
+		{
+			err_msg = "unknown key " + key;
+			return false;
+		}
+	}
+
+	if (has_count == false)
+	{
+		err_msg = "missing count";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Creates the listening Unix domain socket.
+ *
+ * A stale socket file left behind by a crashed daemon is removed, but if another
+ * daemon is still accepting connections on path the call fails.
+ *
+ * @param path The filesystem path of the socket.
+ * @param err_msg Receives a description of the failure.
+ * @return True on success, false otherwise.
+ */
+bool server::Daemon::listen_unix(const std::string& path, std::string& err_msg)
+{
+	sockaddr_un addr{};
+	if (path.empty() || path.size() >= sizeof(addr.sun_path))
+	{
+		err_msg = "Invalid socket path: " + path;
+		return false;
+	}
+	addr.sun_family = AF_UNIX;
+	std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	// refuse to steal the socket of a running daemon
+	int probe{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if (probe != -1)
+	{
+		bool in_use{ connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 };
+		close(probe);
+		if (in_use)
+		{
+			err_msg = "Another daemon is listening on " + path;
+			return false;
+		}
+	}
+	unlink(path.c_str());
+
+	m_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listen_fd == -1)
+	{
+		err_msg = "socket: " + std::string(std::strerror(errno));
+		return false;
+	}
+	if (bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(m_listen_fd, SOMAXCONN) == -1)
+	{
+		err_msg = "bind " + path + ": " + std::string(std::strerror(errno));
+		close(m_listen_fd);
+		m_listen_fd = -1;
+		return false;
+	}
+	m_socket_path = path;
+
+	return add_listener(m_listen_fd, err_msg);
+}
+
+/**
+ * @brief Creates the HTTP listening socket on the loopback interface.
+ *
+ * @param port The TCP port to listen on.
+ * @param err_msg Receives a description of the failure.
+ * @return True on success, false otherwise.
+ */
+bool server::Daemon::listen_http(int port, std::string& err_msg)
+{
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	m_http_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_http_fd == -1)
+	{
+		err_msg = "socket: " + std::string(std::strerror(errno));
+		return false;
+	}
+
+	int reuse{ 1 };
+	setsockopt(m_http_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	if (bind(m_http_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(m_http_fd, SOMAXCONN) == -1)
+	{
+		err_msg = "bind 127.0.0.1:" + std::to_string(port) + ": " + std::string(std::strerror(errno));
+		close(m_http_fd);
+		m_http_fd = -1;
+		return false;
+	}
+
+	return add_listener(m_http_fd, err_msg);
+}
+
+/**
+ * @brief Registers a listening socket with the epoll instance, creating it and the spare descriptor on first use.
+ *
+ * @param fd The listening socket.
+ * @param err_msg Receives a description of the failure.
+ * @return True on success, false otherwise.
+ */
+bool server::Daemon::add_listener(int fd, std::string& err_msg)
+{
+	if (m_epoll_fd == -1 && (m_epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+	{
+		err_msg = "epoll_create1: " + std::string(std::strerror(errno));
+		return false;
+	}
+	if (m_spare_fd == -1 && (m_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+	{
+		err_msg = "open /dev/null: " + std::string(std::strerror(errno));
+		return false;
+	}
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+	{
+		err_msg = "epoll_ctl: " + std::string(std::strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Runs the event loop until stop becomes non-zero.
+ *
+ * @param stop Flag polled after every wakeup, usually set from a signal handler.
+ * @param err_msg Receives a description of the failure.
+ * @return True on a requested shutdown, false if epoll failed.
+ */
+bool server::Daemon::serve(const volatile std::sig_atomic_t& stop, std::string& err_msg)
+{
+	constexpr int max_events{ 256 };
+	epoll_event events[max_events];
+
+	while (stop == 0)
+	{
+		int n{ epoll_wait(m_epoll_fd, events, max_events, -1) };
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			err_msg = "epoll_wait: " + std::string(std::strerror(errno));
+			return false;
+		}
+
+		for (int i{}; i < n; i++)
+		{
+			int fd{ events[i].data.fd };
+			if (fd == m_listen_fd || fd == m_http_fd)
+			{
+				accept_clients(fd);
+				continue;
+			}
+
+			auto it = m_clients.find(fd);
+			if (it == m_clients.end())
+			{
+				continue;
+			}
+
+			bool keep{ (events[i].events & (EPOLLERR | EPOLLHUP)) == 0 };
+			if (keep && (events[i].events & EPOLLIN))
+			{
+				keep = read_client(it->second);
+			}
+			if (keep && it->second.streaming && (events[i].events & EPOLLOUT))
+			{
+				keep = write_client(it->second);
+			}
+			if (keep == false)
+			{
+				close_client(fd);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Accepts every pending connection of a listener and registers it for reading.
+ *
+ * @param listen_fd The listening socket that became readable.
+ */
+void server::Daemon::accept_clients(int listen_fd)
+{
+	while (true)
+	{
+		int fd{ accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+		if (fd == -1)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			if ((errno == EMFILE || errno == ENFILE) && refuse_client(listen_fd))
+			{
+				continue;
+			}
+			return;	// EAGAIN
+		}
+
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		{
+			close(fd);
+			continue;
+		}
+		Client& client = m_clients[fd];
+		client.fd = fd;
+		client.http = (listen_fd == m_http_fd);
+	}
+}
+
+/**
+ * @brief Accepts a pending connection on the spare descriptor and closes it.
+ *
+ * Called when accept fails for lack of descriptors. The connection would otherwise stay
+ * pending and keep the listener readable, and the level-triggered loop would spin on it
+ * until a client leaves. The first refusal is logged, the next one again only after a
+ * client was closed.
+ *
+ * @param listen_fd The listening socket that couldn't be accepted from.
+ * @return True if a connection was refused, false if none was pending or the spare descriptor is gone.
+ */
+bool server::Daemon::refuse_client(int listen_fd)
+{
+	if (m_out_of_fds == false)
+	{
+		std::cerr << "Out of file descriptors with " << m_clients.size() << " clients, refusing new connections until one disconnects" << std::endl;
+		m_out_of_fds = true;
+	}
+	if (m_spare_fd == -1 && (m_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+	{
+		return false;
+	}
+
+	close(m_spare_fd);
+	int fd{ accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC) };
+	if (fd != -1)
+	{
+		close(fd);
+		m_refused++;
+	}
+	m_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	return fd != -1;
+}
+
+/**
+ * @brief Reads whatever the client sent and answers it once the request is complete.
+ *
+ * Unix socket requests end with a newline, HTTP requests with an empty line.
+ *
+ * @param client The client to read from.
+ * @return False if the connection should be closed.
+ */
+bool server::Daemon::read_client(Client& client)
+{
+	char buffer[4096];
+	while (true)
+	{
+		ssize_t n{ recv(client.fd, buffer, sizeof(buffer), 0) };
+		if (n == 0)
+		{
+			if (client.streaming == false)
+			{
+				return false;
+			}
+			// a client may half-close after sending its request, keep streaming to it
+			epoll_event ev{};
+			ev.events = EPOLLOUT;
+			ev.data.fd = client.fd;
+			epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, client.fd, &ev);
+			return true;
+		}
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		if (client.streaming)
+		{
+			continue;	// anything after the request is ignored
+		}
+
+		client.in.append(buffer, static_cast<size_t>(n));
+		size_t end{ client.in.find(client.http ? "\r\n\r\n" : "\n") };
+		if (end != std::string::npos)
+		{
+			std::string request{ client.in.substr(0, end) };
+			client.in.clear();
+			if (client.http)
+			{
+				handle_http(client, request);
+			}
+			else
+			{
+				handle_line(client, request);
+			}
+			return write_client(client);
+		}
+		if (client.in.size() > max_request_size)
+		{
+			client.in.clear();
+			if (client.http)
+			{
+				respond(client, "431 Request Header Fields Too Large", "text/plain", "request too long\n");
+			}
+			else
+			{
+				respond(client, "", "", "ERR request too long\n");
+			}
+			return write_client(client);
+		}
+	}
+}
+
+/**
+ * @brief Answers a request line received on the Unix socket.
+ *
+ * @param client The client that sent the request.
+ * @param line The request line.
+ */
+void server::Daemon::handle_line(Client& client, std::string line)
+{
+	std::string err_msg{};
+	if (line.empty() == false && line.back() == '\r')
+	{
+		line.pop_back();
+	}
+	if (start_stream(client, line, err_msg) == false)
+	{
+		respond(client, "", "", "ERR " + err_msg + "\n");
+	}
+}
+
+/**
+ * @brief Answers an HTTP request.
+ *
+ * Only the request line of the head is interpreted, the headers are ignored and
+ * every response is sent with "Connection: close".
+ *
+ * @param client The client that sent the request.
+ * @param head The request line and headers, without the terminating empty line.
+ */
+void server::Daemon::handle_http(Client& client, const std::string& head)
+{
+	std::istringstream iss(head.substr(0, head.find("\r\n")));
+	std::string method{}, target{}, version{};
+	iss >> method >> target >> version;
+
+	if (version.compare(0, 5, "HTTP/") != 0)
+	{
+		respond(client, "400 Bad Request", "text/plain", "malformed request\n");
+		return;
+	}
+	if (method != "GET")
+	{
+		respond(client, "405 Method Not Allowed", "text/plain", "only GET is supported\n");
+		return;
+	}
+
+	size_t qmark{ target.find('?') };
+	std::string path{ target.substr(0, qmark) };
+	std::string query{ qmark == std::string::npos ? "" : target.substr(qmark + 1) };
+
+	if (path == "/generate")
+	{
+		std::string err_msg{};
+		if (start_stream(client, query, err_msg) == false)
+		{
+			respond(client, "400 Bad Request", "text/plain", err_msg + "\n");
+			return;
+		}
+
+		static const char* content_types[]{ "text/plain", "text/csv", "application/json" };
+		client.out = "HTTP/1.1 200 OK\r\nContent-Type: ";
+		client.out += content_types[static_cast<int>(client.format)];
+		client.out += "\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+		client.chunked = true;
+	}
+	else if (path == "/metrics")
+	{
+		std::ostringstream body;
+		body << "# TYPE ccgen_requests_total counter\nccgen_requests_total " << m_requests << "\n"
+			<< "# TYPE ccgen_rejected_total counter\nccgen_rejected_total " << m_rejected << "\n"
+			<< "# TYPE ccgen_refused_total counter\nccgen_refused_total " << m_refused << "\n"
+			<< "# TYPE ccgen_cards_total counter\nccgen_cards_total " << m_cards_generated << "\n"
+			<< "# TYPE ccgen_bytes_sent_total counter\nccgen_bytes_sent_total " << m_bytes_sent << "\n"
+			<< "# TYPE ccgen_clients gauge\nccgen_clients " << m_clients.size() << "\n"
+			<< "# TYPE ccgen_catalog_entries gauge\nccgen_catalog_entries " << m_catalog->size() << "\n";
+		respond(client, "200 OK", "text/plain; version=0.0.4", body.str());
+	}
+	else if (path == "/catalog")
+	{
+		std::string body{ "[" };
+		for (size_t i{}; i < m_catalog->size(); i++)
+		{
+			body += i == 0 ? "\n{\"issuer\":" : ",\n{\"issuer\":";
+			File::append_json_string(body, m_catalog->issuer(i));
+			body += ",\"length\":" + std::to_string(m_catalog->length(i)) + ",\"prefixes\":";
+			File::append_json_string(body, m_catalog->prefixes(i));
+			body += "}";
+		}
+		body += "\n]\n";
+		respond(client, "200 OK", "application/json", body);
+	}
+	else
+	{
+		respond(client, "404 Not Found", "text/plain", "not found\n");
+	}
+}
+
+/**
+ * @brief Queues a complete response and closes the connection once it's sent.
+ *
+ * @param client The client to answer.
+ * @param status The HTTP status line, ignored for Unix socket clients.
+ * @param content_type The HTTP content type, ignored for Unix socket clients.
+ * @param body The response body.
+ */
+void server::Daemon::respond(Client& client, const std::string& status, const std::string& content_type, const std::string& body)
+{
+	client.streaming = true;
+	client.done = true;
+	client.out_pos = 0;
+	client.out.clear();
+
+	if (client.http)
+	{
+		client.out = "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type +
+			"\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+	}
+	client.out += body;
+
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLOUT;
+	ev.data.fd = client.fd;
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, client.fd, &ev);
+}
+
+/**
+ * @brief Validates a generation request and prepares the client's stream.
+ *
+ * @param client The client that sent the request.
+ * @param query The '&' separated request.
+ * @param err_msg Receives the reason the request was rejected.
+ * @return True if the stream was started, false otherwise.
+ */
+bool server::Daemon::start_stream(Client& client, const std::string& query, std::string& err_msg)
+{
+	Request request{};
+
+	m_requests++;
+	if (parse_request(query, request, err_msg) == false)
+	{
+		m_rejected++;
+		return false;
+	}
+
+	for (size_t i{}; i < m_catalog->size(); i++)
+	{
+		bool selected{ request.issuers.empty() };
+		for (const auto& issuer : request.issuers)
+		{
+			selected |= case_insensitive_equals(issuer, m_catalog->issuer(i));
+		}
+		if (selected)
+		{
+			client.indexes.push_back(static_cast<int>(i));
+		}
+	}
+	if (client.indexes.empty())
+	{
+		err_msg = "no cards match the requested issuers";
+		m_rejected++;
+		return false;
+	}
+
+	if (request.has_seed)
+	{
+		std::seed_seq seq{ static_cast<unsigned>(request.seed), static_cast<unsigned>(request.seed >> 32) };
+		client.rng.seed(seq);
+	}
+	else
+	{
+		client.rng.seed(std::random_device{}());
+	}
+
+	client.format = request.format;
+	client.remaining = request.count;
+	client.header_pending = true;
+	client.streaming = true;
+	client.out.clear();
+	client.out_pos = 0;
+
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLOUT;
+	ev.data.fd = client.fd;
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, client.fd, &ev);
+	return true;
+}
+
+/**
+ * @brief Generates the next batch of the client's stream into its output buffer.
+ *
+ * For HTTP clients the batch is framed as a chunk in place: room for a fixed width
+ * hexadecimal chunk size is reserved before generating and filled in afterwards,
+ * so the generated bytes are sent straight from the buffer they were written to.
+ *
+ * @param client The client to generate for.
+ */
+void server::Daemon::fill(Client& client)
+{
+	std::uniform_int_distribution<int> dist(0, static_cast<int>(client.indexes.size()) - 1);
+	size_t chunk_begin{ client.out.size() };
+
+	if (client.chunked)
+	{
+		client.out.append(chunk_size_digits, '0');
+		client.out += "\r\n";
+	}
+	size_t data_begin{ client.out.size() };
+
+	if (client.header_pending)
+	{
+		File::append_header(client.out, client.format);
+		client.header_pending = false;
+	}
+
+	unsigned long long generated{};
+	while (client.out.size() < batch_bytes && generated < client.remaining)
+	{
+		File::append_record(client.out, *m_catalog, client.indexes[dist(client.rng)], client.format, client.rng, client.first);
+		client.first = false;
+		generated++;
+	}
+	client.remaining -= generated;
+	m_cards_generated += generated;
+
+	if (client.remaining == 0)
+	{
+		File::append_footer(client.out, client.format);
+		client.done = true;
+	}
+
+	if (client.chunked)
+	{
+		size_t data_size{ client.out.size() - data_begin };
+		if (data_size == 0)
+		{
+			client.out.resize(chunk_begin);
+		}
+		else
+		{
+			char digits[chunk_size_digits + 1];
+			std::snprintf(digits, sizeof(digits), "%08x", static_cast<unsigned>(data_size));	// at most a few batches, far below 4 GiB
+			client.out.replace(chunk_begin, chunk_size_digits, digits, chunk_size_digits);
+			client.out += "\r\n";
+		}
+		if (client.done)
+		{
+			client.out += "0\r\n\r\n";
+		}
+	}
+}
+
+/**
+ * @brief Sends as much of the client's stream as the socket accepts.
+ *
+ * At most batches_per_wakeup batches are generated per call, after that the client
+ * yields to the others and continues on its next EPOLLOUT.
+ *
+ * @param client The client to write to.
+ * @return False if the stream is finished or the connection failed.
+ */
+bool server::Daemon::write_client(Client& client)
+{
+	int batches{};
+	while (true)
+	{
+		if (client.out_pos == client.out.size())
+		{
+			if (client.done)
+			{
+				return false;
+			}
+			if (batches++ == batches_per_wakeup)
+			{
+				return true;
+			}
+			client.out.clear();
+			client.out_pos = 0;
+			fill(client);
+			continue;
+		}
+
+		ssize_t n{ send(client.fd, client.out.data() + client.out_pos, client.out.size() - client.out_pos, MSG_NOSIGNAL) };
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		client.out_pos += static_cast<size_t>(n);
+		m_bytes_sent += static_cast<unsigned long long>(n);
+	}
+}
+
+/**
+ * @brief Unregisters and closes a client connection.
+ *
+ * @param fd The client's socket.
+ */
+void server::Daemon::close_client(int fd)
+{
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	m_clients.erase(fd);
+	m_out_of_fds = false;
+}
+
+/**
+ * @brief Loads the catalog and serves generation requests until SIGINT/SIGTERM.
+ *
+ * The catalog is read and validated once at startup, so clients don't pay for opening
+ * the database and validating every row on each run.
+ *
+ * @param socket_path The path of the Unix domain socket to listen on.
+ * @param http_port The localhost TCP port of the HTTP endpoint, 0 disables it.
+ * @param db_path The path of the SQLite catalog to load.
+ * @return 0 on a clean shutdown, 1 if the catalog or a socket couldn't be set up.
+ *
+ * @see server::Daemon
+ */
+int server::run(const std::string& socket_path, int http_port, const std::string& db_path)
+{
+	std::string err_msg{};
+	std::shared_ptr<const Catalog> catalog{};
+
+	if (DB_API::check_file_exists(db_path) == false)
+	{
+		std::cerr << "Couldn't find the database: \"" << db_path << "\"" << std::endl;
+		return 1;
+	}
+
+	std::shared_ptr<CatalogDb> db{ DB_API::read_db(db_path, CatalogDb::Mode::read_only) };
+	if (db == nullptr || DB_API::read_catalog(db, catalog, err_msg) != SQLITE_OK)
+	{
+		std::cerr << "Failed to read the database. " << err_msg << std::endl;
+		return 1;
+	}
+	db.reset();
+
+	struct sigaction sa{};
+	sa.sa_handler = handle_stop_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	server::Daemon daemon{ std::move(catalog) };
+	if (daemon.listen_unix(socket_path, err_msg) == false)
+	{
+		std::cerr << err_msg << std::endl;
+		return 1;
+	}
+	std::cerr << "Serving on " << socket_path << std::endl;
+
+	if (http_port != 0)
+	{
+		if (daemon.listen_http(http_port, err_msg) == false)
+		{
+			std::cerr << err_msg << std::endl;
+			return 1;
+		}
+		std::cerr << "Serving HTTP on http://127.0.0.1:" << http_port << std::endl;
+	}
+
+	if (daemon.serve(s_stop, err_msg) == false)
+	{
+		std::cerr << err_msg << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "DB_API.h"
+#include "Catalog.h"
+#include "File.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <csignal>
+#include <unordered_map>
+
+namespace server
+{
+	/**
+	 * @brief Loads the catalog and serves generation requests until SIGINT/SIGTERM.
+	 *
+	 * @param socket_path The path of the Unix domain socket to listen on.
+	 * @param http_port The localhost TCP port of the HTTP endpoint, 0 disables it.
+	 * @param db_path The path of the SQLite catalog to load.
+	 * @return 0 on a clean shutdown, 1 if the catalog or a socket couldn't be set up.
+	 */
+	int run(const std::string& socket_path, int http_port, const std::string& db_path);
+
+	// Parameters of a single generation request.
+	struct Request
+	{
+		std::vector<std::string> issuers{};				// Issuers to draw from, empty means every issuer.
+		unsigned long long count{};						// Number of cards to generate.
+		File::Format format{ File::Format::plain };		// Output format of the stream.
+		bool has_seed{};								// Whether seed was supplied.
+		unsigned long long seed{};						// Seed for a reproducible stream.
+	};
+
+	// A connected client and the state of the stream it is being served.
+	struct Client
+	{
+		int fd{ -1 };
+		bool http{};									// Connected to the HTTP listener.
+		std::string in{};								// Bytes received but not yet parsed.
+		std::string out{};								// Bytes generated but not yet sent.
+		size_t out_pos{};								// Number of bytes of out already sent.
+		bool streaming{};								// A response is being sent.
+		bool done{};									// Everything was generated, close once out is drained.
+		bool chunked{};									// Frame every batch as an HTTP chunk.
+		bool header_pending{};							// The format header wasn't generated yet.
+		std::vector<int> indexes{};						// Catalog indexes of the requested issuers.
+		unsigned long long remaining{};					// Cards left to generate.
+		File::Format format{ File::Format::plain };
+		bool first{ true };
+		std::mt19937 rng{};
+	};
+
+	/**
+	 * @class Daemon
+	 * @brief Long running generator that serves batches of cards over a Unix domain socket and HTTP.
+	 *
+	 * The catalog is loaded and validated once, clients of the Unix socket then send a single
+	 * request line of '&' separated key=value pairs (issuer, count, format, seed), e.g.
+	 * "issuer=Visa,Mastercard&count=1000&format=csv&seed=42\n".
+	 * The response is streamed back in the requested format and the connection is closed
+	 * once the last card was sent. A rejected request is answered with "ERR <reason>\n".
+	 *
+	 * The optional HTTP/1.1 listener is bound to 127.0.0.1 and serves:
+	 *  - GET /generate?<request>: the same stream, sent with chunked transfer encoding.
+	 *  - GET /metrics: request, card and byte counters in the Prometheus text format.
+	 *  - GET /catalog: the loaded catalog as JSON.
+	 *
+	 * All sockets are non-blocking and multiplexed with a level-triggered epoll loop, each
+	 * writable client gets a bounded slice of generation per wakeup so large requests can't
+	 * starve small ones. When the process runs out of descriptors, new connections are
+	 * accepted on a spare descriptor and closed right away, so the loop doesn't spin on a
+	 * listener it can't drain.
+	 */
+	class Daemon
+	{
+	public:
+		explicit Daemon(std::shared_ptr<const Catalog> catalog) : m_catalog{ std::move(catalog) } {}
+		~Daemon();
+
+		Daemon(const Daemon&) = delete;
+		Daemon& operator=(const Daemon&) = delete;
+
+		// Binds and listens on the Unix domain socket at path.
+		bool listen_unix(const std::string& path, std::string& err_msg);
+
+		// Binds and listens for HTTP connections on 127.0.0.1:port.
+		bool listen_http(int port, std::string& err_msg);
+
+		// Runs the event loop until stop is set.
+		bool serve(const volatile std::sig_atomic_t& stop, std::string& err_msg);
+
+		// Parses a request line, returns false and sets err_msg if it's malformed.
+		static bool parse_request(const std::string& line, Request& request, std::string& err_msg);
+
+		// Decodes %XX escapes and '+' in a request value.
+		static std::string url_decode(const std::string& str);
+
+	private:
+		bool add_listener(int fd, std::string& err_msg);
+		void accept_clients(int listen_fd);
+		bool refuse_client(int listen_fd);
+		bool read_client(Client& client);
+		bool write_client(Client& client);
+		void handle_line(Client& client, std::string line);
+		void handle_http(Client& client, const std::string& head);
+		bool start_stream(Client& client, const std::string& query, std::string& err_msg);
+		void respond(Client& client, const std::string& status, const std::string& content_type, const std::string& body);
+		void fill(Client& client);
+		void close_client(int fd);
+
+		static constexpr size_t max_request_size{ 8192 };	// Longest accepted request line or HTTP head.
+		static constexpr size_t batch_bytes{ 64 * 1024 };	// Bytes generated per batch.
+		static constexpr int batches_per_wakeup{ 4 };		// Batches a client may send before yielding.
+		static constexpr size_t chunk_size_digits{ 8 };		// Width of the hex size of an HTTP chunk.
+
+		std::shared_ptr<const Catalog> m_catalog{};
+		std::unordered_map<int, Client> m_clients{};
+		std::string m_socket_path{};
+		int m_epoll_fd{ -1 };
+		int m_listen_fd{ -1 };
+		int m_http_fd{ -1 };
+		int m_spare_fd{ -1 };							// Kept open to accept and close a connection when out of descriptors.
+		bool m_out_of_fds{};							// Connections are being refused, logged once until a client leaves.
+
+		// counters reported by /metrics
+		unsigned long long m_requests{};
+		unsigned long long m_rejected{};
+		unsigned long long m_refused{};
+		unsigned long long m_cards_generated{};
+		unsigned long long m_bytes_sent{};
+	};
+}
@@ -6,35 +6,310 @@ std::atomic<bool> g_started{ false };
 std::atomic<float> g_progress{ 0.0f };
 
 /**
- * @brief Initializes a vector of Card objects from a database.
+ * @brief Returns a catalog session on the database at db_path.
  *
- * This function initializes a vector of Card objects by reading data from a database file.
- * If the database file does not exist or there is an issue reading the database, an empty
- * vector is returned.
+ * The session of the last path is kept open, so loading and saving the same catalog
+ * again reuses its connection and prepared statements.
  *
- * @return A vector of Card objects initialized from the database.
+ * @param db_path The path of the database.
+ * @return A shared pointer to the session, nullptr if the database couldn't be opened.
  */
-std::vector<Card> initialize_cards_vec()
+static std::shared_ptr<CatalogDb> get_session(const std::string& db_path)
 {
-    std::vector<Card> temp_vec{};
-    std::string db_path = "cards.db";
+    static std::string session_path{};
+    static std::shared_ptr<CatalogDb> session{};
 
-    if (DB_API::check_file_exists(db_path) == false)
+    if (session == nullptr || session_path != db_path)
     {
-        return temp_vec;
+        session = DB_API::read_db(db_path);
+        session_path = db_path;
     }
+    return session;
+}
 
-    std::shared_ptr<sqlite3> db{ DB_API::read_db(db_path) };
+/**
+ * @brief Starts reading a catalog on a background thread.
+ *
+ * The rows are handed to the render loop in chunks as they are read (see take_rows),
+ * the complete catalog is only published by finish.
+ *
+ * @param db The session of the database to read.
+ */
+void gui::CatalogTask::load(std::shared_ptr<CatalogDb> db)
+{
+    join();
+    m_kind = Kind::load;
+    m_done = false;
+    m_cancel = false;
+    m_progress = 0.0f;
+    m_rows.clear();
+    m_result.clear();
+    m_err_msg.clear();
+
+    m_thread = std::thread([this, db]() {
+        std::vector<Card> result{};
+        std::string err_msg{};
+        int rc{ DB_API::read_cards(db, result, err_msg, [this](const std::vector<Card>& cards, float progress) {
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_rows.insert(m_rows.end(), cards.begin(), cards.end());
+            }
+            m_progress = progress;
+            return m_cancel == false;
+            }) };
+
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_result = std::move(result);
+        m_rc = rc;
+        m_err_msg = err_msg;
+        m_done = true;
+        });
+}
+
+/**
+ * @brief Starts writing a catalog on a background thread.
+ *
+ * @param db The session of the database to write.
+ * @param cards The catalog to write, the caller's copy can be edited in the meantime.
+ */
+void gui::CatalogTask::save(std::shared_ptr<CatalogDb> db, std::shared_ptr<const Catalog> catalog)
+{
+    join();
+    m_kind = Kind::save;
+    m_done = false;
+    m_cancel = false;
+    m_progress = 0.0f;
+    m_err_msg.clear();
+
+    m_thread = std::thread([this, db](std::shared_ptr<const Catalog> catalog) {
+        std::string err_msg{};
+        int rc{ DB_API::write_catalog(db, *catalog, err_msg, [this](float progress) { m_progress = progress; }) };
+
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_rc = rc;
+        m_err_msg = err_msg;
+        m_done = true;
+        }, std::move(catalog));
+}
 
-    if (db == nullptr)
+/**
+ * @brief Moves the rows read since the previous call to the end of rows.
+ *
+ * @param rows The rows displayed while loading.
+ */
+void gui::CatalogTask::take_rows(std::vector<Card>& rows)
+{
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    rows.insert(rows.end(), std::make_move_iterator(m_rows.begin()), std::make_move_iterator(m_rows.end()));
+    m_rows.clear();
+}
+
+/**
+ * @brief Collects a finished task.
+ *
+ * A successful load swaps the loaded catalog into cards, anything else leaves cards as it is.
+ *
+ * @param cards The catalog of the application.
+ * @param rc Receives the SQLite result code of the task.
+ * @param err_msg Receives the error message of the task, if any.
+ * @return The kind of the finished task, Kind::none if no task has finished.
+ */
+gui::CatalogTask::Kind gui::CatalogTask::finish(std::vector<Card>& cards, int& rc, std::string& err_msg)
+{
+    if (m_kind == Kind::none || m_done == false)
     {
-        return temp_vec;
+        return Kind::none;
     }
+    join();
 
-    std::string err_msg{};
-    DB_API::read_cards(db, temp_vec, err_msg);
+    Kind kind{ m_kind };
+    m_kind = Kind::none;
+    rc = m_rc;
+    err_msg = m_err_msg;
+    if (kind == Kind::load && rc == SQLITE_OK)
+    {
+        cards.swap(m_result);
+    }
+    m_result.clear();
+    m_rows.clear();
+    return kind;
+}
 
-    return temp_vec;
+/**
+ * @brief Waits for the background thread, if there is one.
+ */
+void gui::CatalogTask::join()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+/**
+ * @brief Cancels a running load and waits for the background thread.
+ *
+ * A running save is completed rather than rolled back.
+ */
+gui::CatalogTask::~CatalogTask()
+{
+    m_cancel = true;
+    join();
+}
+
+/**
+ * @brief Clears the plots and creates the metrics of a new export.
+ *
+ * The metrics of the previous export are released, its thread keeps them alive until it ends.
+ *
+ * @param cards The size of the catalog, the metrics count the cards written of each (for the report).
+ * @return The metrics to set in the options of the export.
+ */
+std::shared_ptr<Metrics> gui::PerformancePanel::start(size_t cards)
+{
+    m_metrics = std::make_shared<Metrics>(cards);
+    m_last = Metrics::Sample{};
+    m_samples = 0;
+    for (std::vector<float>* plot : { &m_cards_rate, &m_mb_rate, &m_generate, &m_write, &m_wait })
+    {
+        plot->clear();
+    }
+    return m_metrics;
+}
+
+/**
+ * @brief Pops the samples of the export and appends a point per sample to every plot.
+ *
+ * A point is the difference between a sample and the one before it, so a sample dropped by a
+ * full ring only makes the next point cover a longer interval.
+ */
+void gui::PerformancePanel::drain()
+{
+    Metrics::Sample sample{};
+    while (m_metrics != nullptr && m_metrics->pop(sample))
+    {
+        double interval{ sample.seconds - m_last.seconds };
+        if (m_samples++ > 0 && interval > 0.0)
+        {
+            auto push = [](std::vector<float>& plot, double value)
+            {
+                if (plot.size() == history)
+                {
+                    plot.erase(plot.begin());
+                }
+                plot.push_back(static_cast<float>(value));
+            };
+            push(m_cards_rate, (sample.cards - m_last.cards) / interval);
+            push(m_mb_rate, (sample.bytes - m_last.bytes) / interval / 1e6);
+            push(m_generate, (sample.generate_seconds - m_last.generate_seconds) / interval * 100.0);
+            push(m_write, (sample.write_seconds - m_last.write_seconds) / interval * 100.0);
+            push(m_wait, (sample.wait_seconds - m_last.wait_seconds) / interval * 100.0);
+        }
+        m_last = sample;
+    }
+}
+
+/**
+ * @brief Draws the totals of the export and the plots of its last history samples.
+ *
+ * @param open Cleared when the window is closed.
+ */
+void gui::PerformancePanel::draw(bool* open)
+{
+    ImGui::SetNextWindowSize(ImVec2(480, 540), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Performance", open) == false)
+    {
+        ImGui::End();
+        return;
+    }
+
+    // a trace records every export that runs until it's stopped, also one that is already running
+    if (Trace::available())
+    {
+        bool recording{ Trace::recording() };
+        if (ImGui::Checkbox("Record trace", &recording))
+        {
+            if (recording)
+            {
+                Trace::start(static_cast<unsigned long long>(m_trace_sample));
+                m_trace_status = "Recording...";
+            }
+            else
+            {
+                size_t events{};
+                m_trace_status = Trace::stop(m_trace_path, events) ? "Wrote " + std::to_string(events) + " events to " + m_trace_path : "Couldn't write " + m_trace_path;
+            }
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+        {
+            ImGui::SetTooltip("Records the stages of the exports as a Chrome trace, open it in chrome://tracing or ui.perfetto.dev");
+        }
+        ImGui::BeginDisabled(Trace::recording());
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+        ImGui::InputText("##trace_path", &m_trace_path);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        ImGui::SliderInt("##trace_sample", &m_trace_sample, 1, 64, "1 batch in %d", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::EndDisabled();
+        if (m_trace_status.empty() == false)
+        {
+            ImGui::TextDisabled("%s", m_trace_status.c_str());
+        }
+        ImGui::Separator();
+    }
+
+    if (m_metrics == nullptr)
+    {
+        ImGui::TextWrapped("Start an export to follow its throughput.");
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Elapsed: %.1f s", m_last.seconds);
+    ImGui::Text("Cards written: %llu", m_last.cards);
+    ImGui::Text("Bytes written: %.2f MB", m_last.bytes / 1e6);
+    ImGui::Text("Resident memory: %.1f MB", m_last.resident_bytes / 1e6);
+
+    // the stage the export thread spent the most time in during the last interval
+    if (m_generate.empty() == false)
+    {
+        const char* bound{ "generating cards (CPU)" };
+        if (m_write.back() > m_generate.back() && m_write.back() >= m_wait.back())
+        {
+            bound = "writing (disk or database)";
+        }
+        else if (m_wait.back() > m_generate.back())
+        {
+            bound = "waiting (paused or paced)";
+        }
+        ImGui::Text("Mostly: %s", bound);
+    }
+    ImGui::Separator();
+
+    ImVec2 plot_size{ -FLT_MIN, ImGui::GetTextLineHeight() * 4 };
+    auto plot = [&](const char* label, const std::vector<float>& values, const char* format, float scale_max)
+    {
+        char overlay[64]{};
+        if (values.empty() == false)
+        {
+            std::snprintf(overlay, sizeof(overlay), format, values.back());
+        }
+        ImGui::TextUnformatted(label);
+        ImGui::PushID(label);
+        ImGui::PlotLines("", values.data(), static_cast<int>(values.size()), 0, overlay, 0.0f, scale_max, plot_size);
+        ImGui::PopID();
+    };
+    plot("Cards/s", m_cards_rate, "%.0f cards/s", FLT_MAX);
+    plot("MB/s", m_mb_rate, "%.2f MB/s", FLT_MAX);
+    plot("Generating", m_generate, "%.0f%%", 100.0f);
+    plot("Writing", m_write, "%.0f%%", 100.0f);
+    plot("Waiting", m_wait, "%.0f%%", 100.0f);
+    if (m_metrics->dropped() > 0)
+    {
+        ImGui::TextDisabled("%llu samples dropped", m_metrics->dropped());
+    }
+    ImGui::End();
 }
 
 class App : public gui::GuiApp<App>
@@ -51,6 +326,20 @@ public:
         m_window_flags |= ImGuiWindowFlags_NoTitleBar;
         ImGui_ImplGlfw_InitForOpenGL(m_window, true);
         m_duration = File::estimate_time< std::chrono::nanoseconds>();
+
+        // load the default catalog without blocking the first frame
+        std::string db_path{ "cards.db" };
+        std::shared_ptr<CatalogDb> db{ DB_API::check_file_exists(db_path) ? get_session(db_path) : nullptr };
+        if (db != nullptr)
+        {
+            m_catalog_task.load(db);
+        }
+    }
+
+    // A running export or a catalog load or save moves the progress bars without any input.
+    bool busy()
+    {
+        return (g_started && g_paused == false) || m_catalog_task.kind() != gui::CatalogTask::Kind::none;
     }
 
     void update()
@@ -60,6 +349,7 @@ public:
         ImGui::SetNextWindowSize(viewport->WorkSize);
 
         static bool disable_start_btn;
+        static bool show_performance{ false };
 
         // ImGui content
         ImGui::Begin("MainWindow", NULL, m_window_flags);
@@ -67,20 +357,101 @@ public:
         ImVec2 main_window_size{ ImGui::GetWindowSize() };
         ImVec2 popup_min_window_size{ ImVec2(main_window_size.x * 0.5f, main_window_size.y * 0.5f) };
 
-        static std::vector<Card> cards_vec{ initialize_cards_vec()};
+        static std::vector<Card> cards_vec{};
         static std::vector<bool> cards_selection( cards_vec.size(), false );
         static int current_card{-1};
+        static std::vector<Card> loading_rows{};
+        static std::string err_msg{};
+        static bool show_db_error{ false };
+        static size_t checked_rows{};
+        static unsigned long long catalog_edits{};      // bumped by every change to cards_vec
+        static unsigned long long published_edits{};
+
+        // the version of the catalog exports and saves start with, cards_vec stays editable while they run
+        auto snapshot = [this]() -> std::shared_ptr<const Catalog>
+        {
+            if (published_edits != catalog_edits)
+            {
+                m_catalog_store.publish(cards_vec);
+                published_edits = catalog_edits;
+            }
+            return m_catalog_store.current();
+        };
 
-        ImGui::BeginDisabled(g_started);
+        // show the rows of a running load, swap the catalog in once it's complete
+        if (m_catalog_task.kind() == gui::CatalogTask::Kind::load)
+        {
+            m_catalog_task.take_rows(loading_rows);
+        }
+        int task_rc{};
+        gui::CatalogTask::Kind finished{ m_catalog_task.finish(cards_vec, task_rc, err_msg) };
+        if (finished != gui::CatalogTask::Kind::none)
+        {
+            loading_rows.clear();
+            if (task_rc != SQLITE_OK)
+            {
+                show_db_error = true;
+            }
+            else if (finished == gui::CatalogTask::Kind::load)
+            {
+                cards_selection = std::vector<bool>(cards_vec.size(), false);
+                checked_rows = 0;
+                current_card = -1;
+                catalog_edits++;
+            }
+        }
+        const bool catalog_busy{ m_catalog_task.kind() != gui::CatalogTask::Kind::none };
+        const bool loading{ m_catalog_task.kind() == gui::CatalogTask::Kind::load };
+
+        ImGui::BeginDisabled(loading);
         // Child 1 - Database
         {
-            static ImGuiTextFilter db_filter{};
+            static std::string db_filter{};
             ImVec2 child_window_size{ ImGui::GetContentRegionAvail() };
             ImGui::BeginChild("Child_L", ImVec2(child_window_size.x * 0.5f, child_window_size.y), false, ImGuiWindowFlags_NoDecoration);
             // Child 1.1 - Database list
             {
                 ImGui::BeginChild("Child_L_1", ImVec2(0, ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeightWithSpacing()), false, ImGuiWindowFlags_HorizontalScrollbar);
 
+                // the rows that match the filter, searched again when the filter or the catalog changes;
+                // the index is built on the first search after an edit, the rows of a running load
+                // are checked one by one as they arrive
+                static std::vector<int> visible_rows{};
+                static std::string visible_filter{};
+                static SearchIndex::Query visible_query{ "" };
+                static unsigned long long visible_edits{};
+                static size_t visible_checked{};
+                static bool visible_loading{};
+                static SearchIndex search_index{};
+                static unsigned long long indexed_edits{ ~0ULL };
+                const std::vector<Card>& rows{ loading ? loading_rows : cards_vec };
+                if (visible_filter != db_filter || visible_edits != catalog_edits || visible_loading != loading || visible_checked > rows.size())
+                {
+                    visible_rows.clear();
+                    visible_checked = 0;
+                    visible_filter = db_filter;
+                    visible_query = SearchIndex::Query{ db_filter };
+                    visible_edits = catalog_edits;
+                    visible_loading = loading;
+                    if (loading == false && visible_query.empty() == false)
+                    {
+                        if (indexed_edits != catalog_edits)
+                        {
+                            search_index.build(cards_vec);
+                            indexed_edits = catalog_edits;
+                        }
+                        search_index.search(visible_query, visible_rows);
+                        visible_checked = cards_vec.size();
+                    }
+                }
+                for (; visible_checked < rows.size(); visible_checked++)
+                {
+                    if (visible_query.empty() || visible_query.matches(rows[visible_checked]))
+                    {
+                        visible_rows.push_back(static_cast<int>(visible_checked));
+                    }
+                }
+
                 if (ImGui::BeginTable("cards_columns", 4, ImGuiTableFlags_Resizable | ImGuiTableFlags_NoSavedSettings | ImGuiTableFlags_Borders))
                 {
                     static std::array<const char*, 4> table_header{ "", "Issuer" ,"Length" ,"Prefixes" };
@@ -90,29 +461,27 @@ public:
                         ImGui::TextColored(ImVec4(255, 0, 0, 1), header_col);
                     }
 
-                    bool sel{};
-                    disable_start_btn = false;
-                    for(size_t i{}; i<cards_vec.size();i++)
+                    // only the rows in view are submitted, a million cards cost as much as a screenful
+                    ImGuiListClipper clipper{};
+                    clipper.Begin(static_cast<int>(visible_rows.size()));
+                    while (clipper.Step())
                     {
-                        std::string issuer_str{ cards_vec[i].get_issuer()};
-                        std::string length_str{ std::to_string(cards_vec[i].get_len()) };
-                        std::string prefixes_str{ cards_vec[i].get_prefixes() };
-
-                        const char* issuer{ issuer_str.c_str() };
-                        const char* length{ length_str.c_str() };
-                        const char* prefixes{ prefixes_str.c_str() };
-                        if (db_filter.PassFilter(issuer) || db_filter.PassFilter(length) || db_filter.PassFilter(prefixes))
+                        for (int row{ clipper.DisplayStart }; row < clipper.DisplayEnd; row++)
                         {
+                            const int i{ visible_rows[row] };
+                            const Card& card{ rows[i] };
+                            ImGui::PushID(i);
                             ImGui::TableNextRow();
                             ImGui::TableNextColumn();
-                            // if you have a better and more efficient solution then please suggest it =)
-                            sel = cards_selection[i];
-                            ImGui::Checkbox(("##checkbox_"+std::to_string(i)).c_str(), &sel);
-                            cards_selection[i] = sel;
-                            disable_start_btn |= sel;
+                            bool sel{ loading == false && cards_selection[i] };
+                            if (ImGui::Checkbox("##checked", &sel) && loading == false)
+                            {
+                                cards_selection[i] = sel;
+                                sel ? checked_rows++ : checked_rows--;
+                            }
 
                             ImGui::TableNextColumn();
-                            if (ImGui::Selectable(issuer, current_card == i, ImGuiSelectableFlags_SpanAllColumns))
+                            if (ImGui::Selectable(card.get_issuer().c_str(), current_card == i, ImGuiSelectableFlags_SpanAllColumns))
                             {
                                 if (current_card == i)
                                 {
@@ -125,15 +494,15 @@ public:
                             }
 
                             ImGui::TableNextColumn();
-                            ImGui::Text(length);
+                            ImGui::Text("%d", card.get_len());
                             ImGui::TableNextColumn();
-                            ImGui::Text(prefixes);
+                            ImGui::TextUnformatted(card.get_prefixes().c_str(), card.get_prefixes().c_str() + card.get_prefixes().size());
+                            ImGui::PopID();
                         }
-
                     }
-                    disable_start_btn = !disable_start_btn;
                     ImGui::EndTable();
                 }
+                disable_start_btn = checked_rows == 0;
                 ImGui::EndChild();
             }
             ImGui::Separator();
@@ -142,7 +511,11 @@ public:
                 ImGui::BeginChild("Child_L_2", ImVec2(0, 0), false, ImGuiWindowFlags_NoDecoration);
                 ImGui::Text("Filter:");
                 ImGui::SameLine();
-                db_filter.Draw("##db_filter");
+                ImGui::InputTextWithHint("##db_filter", "Issuer, length or a prefix, e.g. visa 4571", &db_filter);
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+                {
+                    ImGui::SetTooltip("Every word must match the issuer, the length or a range of the card.\nA number finds the cards whose ranges cover it, 51-55 the ranges that overlap it.");
+                }
                 ImGui::EndChild();
             }
             ImGui::EndChild();
@@ -159,7 +532,7 @@ public:
             // Child 2.1 - Database actions
             {
                 ImGui::BeginChild("Child_R1", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.3f), false, ImGuiWindowFlags_HorizontalScrollbar);
-                static const std::array<const char*, 8> db_actions{
+                static const std::array<const char*, 9> db_actions{
                     "Clear",
                     "Open",
                     "Save",
@@ -168,8 +541,10 @@ public:
                     "Remove",
                     "Check all",
                     "Uncheck all",
+                    "Lint",
                 };
-                static std::string err_msg{};
+                static std::vector<Linter::Finding> lint_findings{};
+                static std::string lint_status{};
                 static size_t action;
                 action = db_actions.size();
                 static constexpr const char* filters{ "Sqlite database files (*.db){.db},All files (*.*){.*}" };
@@ -181,7 +556,7 @@ public:
                     for (size_t i{}; i < db_actions.size(); i++)
                     {
                         ImGui::TableNextColumn();
-                        ImGui::BeginDisabled(g_started);
+                        ImGui::BeginDisabled(catalog_busy);
                         if (ImGui::Button(db_actions[i], button_size))
                         {
                             action = i;
@@ -191,6 +566,13 @@ public:
                     ImGui::EndTable();
                 }
 
+                // progress of a background load or save
+                if (catalog_busy)
+                {
+                    std::string overlay{ loading ? "Loading... " + std::to_string(loading_rows.size()) + " cards" : std::string("Saving...") };
+                    ImGui::ProgressBar(m_catalog_task.progress(), ImVec2(-FLT_MIN, 0), overlay.c_str());
+                }
+
                 // Handle db actions
                 switch (action)
                 {
@@ -219,15 +601,25 @@ public:
                 case 5: // remove card
                     if (current_card < cards_vec.size())
                     {
+                        checked_rows -= cards_selection[current_card] ? 1 : 0;
                         cards_vec.erase(std::next(cards_vec.begin(), current_card), std::next(cards_vec.begin(), current_card + 1));
                         cards_selection.erase(std::next(cards_selection.begin(), current_card), std::next(cards_selection.begin(), current_card + 1));
+                        current_card = -1;
+                        catalog_edits++;
                     }
                     break;
                 case 6: // select all
                     std::fill(cards_selection.begin(), cards_selection.end(), true);
+                    checked_rows = cards_selection.size();
                     break;
                 case 7:
                     std::fill(cards_selection.begin(), cards_selection.end(), false);
+                    checked_rows = 0;
+                    break;
+                case 8: // lint
+                    lint_findings = Linter::lint(cards_vec);
+                    lint_status.clear();
+                    ImGui::OpenPopup("Lint");
                     break;
                 default:
                     break;
@@ -246,6 +638,9 @@ public:
                     {
                         cards_vec.clear();
                         cards_selection.clear();
+                        checked_rows = 0;
+                        current_card = -1;
+                        catalog_edits++;
                         ImGui::CloseCurrentPopup();
                     }
                     ImGui::SameLine();
@@ -271,7 +666,7 @@ public:
                         }
                         else
                         {
-                            std::shared_ptr<sqlite3> db{ DB_API::read_db(db_path) };
+                            std::shared_ptr<CatalogDb> db{ get_session(db_path) };
 
                             if (db == nullptr)
                             {
@@ -280,14 +675,7 @@ public:
                             }
                             else
                             {
-                                if (DB_API::read_cards(db, cards_vec, err_msg) == 0)
-                                {
-                                    cards_selection = std::vector<bool>(cards_vec.size(), false);
-                                }
-                                else
-                                {
-                                    ImGui::OpenPopup("DB Error");
-                                }
+                                m_catalog_task.load(db);
                             }
                         }
                     }
@@ -302,7 +690,7 @@ public:
                     {
                         std::string db_path = ImGuiFileDialog::Instance()->GetFilePathName();
 
-                        std::shared_ptr<sqlite3> db{ DB_API::read_db(db_path) };
+                        std::shared_ptr<CatalogDb> db{ get_session(db_path) };
 
                         if (db == nullptr)
                         {
@@ -311,10 +699,7 @@ public:
                         }
                         else
                         {
-                            if (DB_API::write_cards(db, cards_vec, err_msg) != 0)
-                            {
-                                ImGui::OpenPopup("DB Error");
-                            }
+                            m_catalog_task.save(db, snapshot());
                         }
                     }
                     ImGuiFileDialog::Instance()->Close();
@@ -356,6 +741,11 @@ public:
                     {
                         ImGui::SetTooltip("Comma delimited, either digits and/or ascending ranges larger then the length.\ne.g.: 1,2,4-5,7,89-1000");
                     }
+                    Card::PrefixError prefix_error{};
+                    if (prefixes_add.empty() == false && Card::validate_prefix(prefixes_add, length_add, &prefix_error) == false)
+                    {
+                        ImGui::TextColored(ImVec4(255, 0, 0, 1), "%s at position %zu", prefix_error.message, prefix_error.position + 1);
+                    }
 
                     ImGui::SetCursorPos(ImVec2(popup_window_size.x / 2 - button_size.x, popup_window_size.y - button_size.y * 2));
                     ImGui::BeginDisabled(Card::validate_card(issuer_add, length_add, prefixes_add) == false);
@@ -367,6 +757,7 @@ public:
                         {
                             cards_vec.push_back(new_card);
                             cards_selection.push_back(false);
+                            catalog_edits++;
                         }
                         first_time = true;
                         ImGui::CloseCurrentPopup();
@@ -417,6 +808,11 @@ public:
                     {
                         ImGui::SetTooltip("Comma delimited, either digits and/or ascending ranges larger then the length.\ne.g.: 1,2,4-5,7,89-1000");
                     }
+                    Card::PrefixError prefix_error{};
+                    if (prefixes_add.empty() == false && Card::validate_prefix(prefixes_add, length_add, &prefix_error) == false)
+                    {
+                        ImGui::TextColored(ImVec4(255, 0, 0, 1), "%s at position %zu", prefix_error.message, prefix_error.position + 1);
+                    }
 
                     ImGui::SetCursorPos(ImVec2(popup_window_size.x / 2 - button_size.x, popup_window_size.y - button_size.y * 2));
                     ImGui::BeginDisabled(Card::validate_card(issuer_add, length_add, prefixes_add) == false);
@@ -431,6 +827,7 @@ public:
                             cards_vec[current_card].set_issuer(issuer_add);
                             cards_vec[current_card].set_len(length_add);
                             cards_vec[current_card].set_prefixes(prefixes_add);
+                            catalog_edits++;
                         }
                         ImGui::CloseCurrentPopup();
                         action = db_actions.size();
@@ -451,7 +848,51 @@ public:
                     ImGui::EndPopup();
                 }
 
+                // lint
+                ImGui::SetNextWindowSizeConstraints(popup_min_window_size, ImVec2(FLT_MAX, FLT_MAX));
+                if (ImGui::BeginPopupModal("Lint"))
+                {
+                    ImVec2 popup_window_size{ ImGui::GetWindowSize() };
+                    ImVec2 button_size{ ImVec2(popup_window_size.x * 0.3f, popup_window_size.y * 0.1f) };
+                    ImGui::Text("%zu findings in %zu cards. %s", lint_findings.size(), cards_vec.size(), lint_status.c_str());
+
+                    ImGui::BeginChild("lint_findings", ImVec2(0, ImGui::GetContentRegionAvail().y - button_size.y * 1.5f), true, ImGuiWindowFlags_HorizontalScrollbar);
+                    ImGuiListClipper clipper{};
+                    clipper.Begin(static_cast<int>(lint_findings.size()));
+                    while (clipper.Step())
+                    {
+                        for (int i{ clipper.DisplayStart }; i < clipper.DisplayEnd; i++)
+                        {
+                            ImGui::TextUnformatted(Linter::describe(cards_vec, lint_findings[i]).c_str());
+                        }
+                    }
+                    ImGui::EndChild();
+
+                    if (ImGui::Button("Merge", button_size))
+                    {
+                        size_t removed{ Linter::merge(cards_vec) };
+                        lint_findings = Linter::lint(cards_vec);
+                        catalog_edits += removed > 0 ? 1 : 0;
+                        lint_status = "Removed " + std::to_string(removed) + " ranges, save to keep them.";
+                    }
+                    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+                    {
+                        ImGui::SetTooltip("Drops duplicate and shadowed ranges and merges overlapping and adjacent ranges of the same card");
+                    }
+                    ImGui::SameLine();
+                    if (ImGui::Button("Close", button_size))
+                    {
+                        ImGui::CloseCurrentPopup();
+                    }
+                    ImGui::EndPopup();
+                }
+
                 // error message box
+                if (show_db_error)
+                {
+                    ImGui::OpenPopup("DB Error");
+                    show_db_error = false;
+                }
                 ImGui::SetNextWindowSizeConstraints(ImVec2(main_window_size.x * 0.25f, main_window_size.y * 0.25f), ImVec2(FLT_MAX, FLT_MAX));
                 if (ImGui::BeginPopupModal("DB Error"))
                 {
@@ -474,6 +915,14 @@ public:
             static constexpr DATATYPE min_amount{ 1 };
             static constexpr DATATYPE max_amount{ std::numeric_limits<DATATYPE>::max() / 2 };
             static DATATYPE amount{ min_amount };
+            static File::StopCondition stop{};
+            static int stop_mode{};
+            static int size_unit{ 3 };
+            static int time_unit{ 1 };
+            static const char* stop_modes[]{ "Cards", "Size", "Time" };
+            static const char* size_units[]{ "B", "KB", "MB", "GB", "TB" };
+            static const char* time_units[]{ "Seconds", "Minutes", "Hours" };
+            static constexpr unsigned long long time_unit_seconds[]{ 1, 60, 3600 };
 
             // Child 2.2 - Database input
             ImGui::Separator();
@@ -482,24 +931,63 @@ public:
 
                 ImGui::BeginChild("Child_R2", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.5f), false, ImGuiWindowFlags_HorizontalScrollbar);
                 {
-                    ImGui::Text("Amount:");
-                    ImGui::SameLine();
                     static std::string f_time{ File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_duration * amount)) };
-                    ImGui::DragScalar("##amount_slider", imgui_data_type, &amount, 1.0f, &min_amount, &max_amount, 0, ImGuiSliderFlags_AlwaysClamp);
                     static std::string size_str{ File::estimate_size(amount) };
+                    float combo_width{ ImGui::GetContentRegionAvail().x * 0.25f };
+
+                    ImGui::Text("Stop after:");
+                    ImGui::SameLine();
+                    ImGui::SetNextItemWidth(combo_width);
+                    bool edited{ ImGui::Combo("##stop_mode", &stop_mode, stop_modes, IM_ARRAYSIZE(stop_modes)) };
 
-                    // Calculate the total size of the file including newline characters
-                    if(ImGui::IsItemEdited())
+                    ImGui::Text("Amount:");
+                    ImGui::SameLine();
+                    if (stop_mode > 0)
                     {
-                        size_str = File::estimate_size(amount);
-                        f_time = File::format_time<std::chrono::nanoseconds, DATATYPE>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_duration * amount));
+                        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - combo_width - ImGui::GetStyle().ItemSpacing.x);
                     }
+                    ImGui::DragScalar("##amount_slider", imgui_data_type, &amount, 1.0f, &min_amount, &max_amount, 0, ImGuiSliderFlags_AlwaysClamp);
+                    edited |= ImGui::IsItemEdited();
 
                     if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
                     {
                         ImGui::SetTooltip("Hold and drag, or double click to enter a value.");
                     }
 
+                    if (stop_mode == 1)
+                    {
+                        ImGui::SameLine();
+                        ImGui::SetNextItemWidth(combo_width);
+                        edited |= ImGui::Combo("##size_unit", &size_unit, size_units, IM_ARRAYSIZE(size_units));
+                    }
+                    else if (stop_mode == 2)
+                    {
+                        ImGui::SameLine();
+                        ImGui::SetNextItemWidth(combo_width);
+                        edited |= ImGui::Combo("##time_unit", &time_unit, time_units, IM_ARRAYSIZE(time_units));
+                    }
+
+                    // Calculate the stop condition and the estimates of the other two
+                    if (edited)
+                    {
+                        unsigned long long est_cards{ amount };
+                        stop.mode = static_cast<File::StopMode>(stop_mode);
+                        stop.value = amount;
+                        if (stop.mode == File::StopMode::bytes)
+                        {
+                            stop.value = std::min<unsigned long long>(amount, File::unlimited >> (10 * size_unit)) << (10 * size_unit);
+                            est_cards = stop.value / File::typical_record_bytes;
+                        }
+                        else if (stop.mode == File::StopMode::time)
+                        {
+                            stop.value = amount * time_unit_seconds[time_unit];
+                            est_cards = static_cast<unsigned long long>(std::chrono::seconds(stop.value) / std::max(m_duration, std::chrono::nanoseconds(1)));
+                        }
+
+                        size_str = stop.mode == File::StopMode::bytes ? File::format_size(static_cast<double>(stop.value)) : File::estimate_size(est_cards);
+                        f_time = File::format_time<std::chrono::nanoseconds, DATATYPE>(stop.mode == File::StopMode::time ? std::chrono::nanoseconds(std::chrono::seconds(stop.value)) : std::chrono::duration_cast<std::chrono::nanoseconds>(m_duration * est_cards));
+                    }
+
                     // print estimated file size
                     ImGui::Text("Approximate size:");
                     ImGui::SameLine();
@@ -529,6 +1017,7 @@ public:
                     ImVec2 button_size{ ImVec2(window_size.x * 0.2f,window_size.y * 0.35f) };
 
                     static std::string start_button_text{ "Start" };
+                    static std::string file_error{};     // Message of the "File Error" popup.
 
                     ImGui::BeginDisabled(disable_start_btn);
                     if (ImGui::Button(start_button_text.c_str(), button_size))
@@ -547,7 +1036,7 @@ public:
                         }
                         else
                         {
-                            ImGuiFileDialog::Instance()->OpenDialog("GenerateDlg", "Save Cards", "Text Documents (*.txt){.txt},All files (*.*){.*}", ".", "", 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
+                            ImGuiFileDialog::Instance()->OpenDialog("GenerateDlg", "Save Cards", "Text Documents (*.txt){.txt},SQLite databases (*.db){.db},All files (*.*){.*}", ".", "", 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
                         }
                     }
                     ImGui::EndDisabled();
@@ -557,31 +1046,63 @@ public:
                         if (ImGuiFileDialog::Instance()->IsOk())
                         {
                             std::string exp_path = ImGuiFileDialog::Instance()->GetFilePathName();
-                            static std::ofstream output_file;
-                            output_file.open(exp_path.c_str(), std::ios::trunc);
+                            std::shared_ptr<const Catalog> catalog{ snapshot() };
+                            std::unique_ptr<Sink> sink{};
+                            if (SqliteSink::is_database_path(exp_path))
+                            {
+                                SqliteSink::Options table_options{};
+                                table_options.issuer_columns = true;
+                                std::string err_msg{};
+                                sink = SqliteSink::open(exp_path, catalog, table_options, err_msg);
+                            }
+                            else if (std::FILE* output_file{ std::fopen(exp_path.c_str(), "wb") })
+                            {
+                                sink.reset(new FileSink(output_file));
+                            }
 
-                            if (output_file.is_open())
+                            if (sink != nullptr)
                             {
                                 start_button_text = "Pause";
                                 g_started = true;
                                 g_progress = 0.0f;
-                                std::thread write_thread(&File::export_cards<DATATYPE>, std::ref(output_file), cards_vec, cards_selection, amount);
+                                File::ExportOptions options{};
+                                options.seed = File::random_seed();
+                                options.metrics = m_performance.start(catalog->size());
+                                m_report_path = File::default_report_path(exp_path);
+                                *m_report_failed = false;
+                                options.report_path = m_report_path;
+                                // the loop may be asleep in glfwWaitEvents once busy() turns false, wake it for the final frame
+                                options.finished = [report_failed = m_report_failed, report = m_report_path.empty() == false](const File::ExportResult& result)
+                                {
+                                    *report_failed = report && result.report_written == false;
+                                    glfwPostEmptyEvent();
+                                };
+                                unsigned long long total{ File::apply_stop(stop, options) };
+                                std::thread write_thread(&File::export_cards<unsigned long long>, std::move(sink), catalog, cards_selection, total, options);
                                 write_thread.detach();
                             }
                             else
                             {
+                                file_error = "Couldn't open file";
                                 ImGui::OpenPopup("File Error");
                             }
                         }
                         ImGuiFileDialog::Instance()->Close();
                     }
 
+                    // the export thread only sets the flag, the popup opens on the next frame
+                    if (m_report_failed->exchange(false))
+                    {
+                        file_error = "Couldn't write the report \"" + m_report_path + "\"";
+                        ImGui::OpenPopup("File Error");
+                    }
+
                     ImGui::SetNextWindowSizeConstraints(ImVec2(main_window_size.x * 0.25f, main_window_size.y * 0.25f), ImVec2(FLT_MAX, FLT_MAX));
                     if (ImGui::BeginPopupModal("File Error"))
                     {
                         ImVec2 popup_window_size{ ImGui::GetWindowSize() };
                         ImVec2 button_size{ ImVec2(popup_window_size.x * 0.3f, popup_window_size.y * 0.15f) };
-                        ImGui::TextWrapped("Couldn't open file");
+                        ImGui::TextWrapped("%s", file_error.c_str());
                         ImGui::SetCursorPos(ImVec2(popup_window_size.x / 2 - button_size.x / 2, popup_window_size.y - button_size.y * 2));
 
                         if (ImGui::Button("OK", button_size))
@@ -602,6 +1123,19 @@ public:
                     }
                     ImGui::EndDisabled();
 
+                    // how often the progress is redrawn while a job runs, the window sleeps in between
+                    static int refresh_rate{ 10 };
+                    ImGui::SameLine();
+                    ImGui::SetNextItemWidth(-FLT_MIN);
+                    if (ImGui::SliderInt("##refresh_rate", &refresh_rate, 1, 60, "%d updates/s", ImGuiSliderFlags_AlwaysClamp))
+                    {
+                        set_refresh_rate(refresh_rate);
+                    }
+                    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+                    {
+                        ImGui::SetTooltip("How many times a second the progress is redrawn during an export");
+                    }
+
                     ImGui::SetNextWindowSizeConstraints(ImVec2(main_window_size.x * 0.25f, main_window_size.y * 0.25f), ImVec2(FLT_MAX, FLT_MAX));
                     if (ImGui::BeginPopupModal("Stop"))
                     {
@@ -666,6 +1200,14 @@ public:
 
                 ImGui::SameLine();
 
+                // Performance button
+                if (ImGui::Button("Performance", button_size))
+                {
+                    show_performance = !show_performance;
+                }
+
+                ImGui::SameLine();
+
                 // About button
                 if (ImGui::Button("About", button_size))
                 {
@@ -719,6 +1261,12 @@ public:
         ImGui::GetWindowDrawList()->AddLine(ImVec2(main_window_size.x * 0.5f + spaceBetween * 0.5f, 0), ImVec2(main_window_size.x * 0.5f + spaceBetween * 0.5f, main_window_size.y), ImGui::GetColorU32(ImGuiCol_Separator));
 
         ImGui::End();
+
+        m_performance.drain();
+        if (show_performance)
+        {
+            m_performance.draw(&show_performance);
+        }
     }
 private:
     ImGuiWindowFlags m_window_flags{};
@@ -726,6 +1274,11 @@ private:
     std::string m_url{};
     std::string m_license{};
     std::chrono::nanoseconds m_duration{};
+    gui::CatalogTask m_catalog_task{};
+    CatalogStore m_catalog_store{};
+    gui::PerformancePanel m_performance{};
+    std::string m_report_path{};                                // Report of the last export, empty if it has none.
+    std::shared_ptr<std::atomic<bool>> m_report_failed{ std::make_shared<std::atomic<bool>>(false) };  // Set by the export thread.
 };
 
 /**
@@ -9,6 +9,7 @@
 #include <limits>
 #include <atomic>
 #include <chrono>
+#include <mutex>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -20,6 +21,10 @@
 
 #include "DB_API.h"
 #include "Card.h"
+#include "Linter.h"
+#include "SearchIndex.h"
+#include "SqliteSink.h"
+#include "Metrics.h"
 #include "File.h"
 
 #if defined(_WIN64) || defined(_WIN32)
@@ -56,6 +61,100 @@ namespace gui
      */
     void run(const std::string& version, const std::string& url, const std::string& license);
 
+    /**
+     * @class CatalogTask
+     * @brief Loads or saves the catalog on a background thread.
+     *
+     * The render loop keeps running while the database is read or written: it polls the
+     * progress, takes the rows read so far to display them and, once the task has finished,
+     * swaps the loaded catalog in with a single vector swap. A failed or cancelled load
+     * leaves the current catalog untouched. Only one task runs at a time.
+     */
+    class CatalogTask
+    {
+    public:
+        enum class Kind
+        {
+            none,
+            load,
+            save
+        };
+
+        CatalogTask() = default;
+        CatalogTask(const CatalogTask&) = delete;
+        CatalogTask& operator=(const CatalogTask&) = delete;
+        ~CatalogTask();
+
+        // Starts reading the catalog of db on a background thread.
+        void load(std::shared_ptr<CatalogDb> db);
+
+        // Starts writing a catalog snapshot to db on a background thread.
+        void save(std::shared_ptr<CatalogDb> db, std::shared_ptr<const Catalog> catalog);
+
+        // The running (or finished but not yet collected) task, Kind::none if there is none.
+        Kind kind() const { return m_kind; }
+
+        // Fraction of the task done.
+        float progress() const { return m_progress; }
+
+        // Appends the rows read since the previous call to rows.
+        void take_rows(std::vector<Card>& rows);
+
+        // Returns the kind of a finished task and collects it, Kind::none while it's still running.
+        Kind finish(std::vector<Card>& cards, int& rc, std::string& err_msg);
+
+    private:
+        void join();
+
+        Kind m_kind{ Kind::none };
+        std::thread m_thread{};
+        std::atomic<bool> m_done{ false };
+        std::atomic<bool> m_cancel{ false };
+        std::atomic<float> m_progress{ 0.0f };
+        std::mutex m_mutex{};
+        std::vector<Card> m_rows{};     // Rows read since the last take_rows.
+        std::vector<Card> m_result{};   // The loaded catalog.
+        int m_rc{};
+        std::string m_err_msg{};
+    };
+
+    /**
+     * @class PerformancePanel
+     * @brief Plots the throughput of the running export.
+     *
+     * Every frame the panel drains the samples the export pushed to its Metrics and turns two
+     * consecutive samples into a point of each plot: cards/s, MB/s and the share of the time the
+     * export thread spent generating, writing and waiting. The plots keep the last history points.
+     * A build with tracing can also record a trace of the exports from the panel (see Trace).
+     */
+    class PerformancePanel
+    {
+    public:
+        // Starts following a new export of a catalog of cards cards, returns the metrics to pass in its options.
+        std::shared_ptr<Metrics> start(size_t cards);
+
+        // Turns the samples pushed since the previous call into points, called every frame so the ring never fills.
+        void drain();
+
+        // Draws the panel as a window of its own, open is cleared when it's closed.
+        void draw(bool* open);
+
+    private:
+        static constexpr size_t history{ 300 };     // Points of each plot, 30 seconds at the sample interval.
+
+        std::shared_ptr<Metrics> m_metrics{};
+        Metrics::Sample m_last{};                   // The newest sample.
+        size_t m_samples{};                         // Samples drained from the current export.
+        std::vector<float> m_cards_rate{};
+        std::vector<float> m_mb_rate{};
+        std::vector<float> m_generate{};            // Percent of the time spent in each stage.
+        std::vector<float> m_write{};
+        std::vector<float> m_wait{};
+        std::string m_trace_path{ "trace.json" };
+        int m_trace_sample{ 1 };                    // Batches per traced batch.
+        std::string m_trace_status{};               // Outcome of the last recording.
+    };
+
     /**
     * @brief Template class for creating GUI applications using GLFW and ImGui.
     *
@@ -126,6 +225,18 @@ namespace gui
 
             ImGui_ImplOpenGL3_Init("#version 330");
             glfwSwapInterval(1);    // idling
+
+            // every input wakes the loop, the ImGui backend chains its own callbacks to these
+            glfwSetWindowUserPointer(m_window, this);
+            glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double) { on_input(window); });
+            glfwSetCursorEnterCallback(m_window, [](GLFWwindow* window, int) { on_input(window); });
+            glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int) { on_input(window); });
+            glfwSetScrollCallback(m_window, [](GLFWwindow* window, double, double) { on_input(window); });
+            glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int) { on_input(window); });
+            glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int) { on_input(window); });
+            glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int) { on_input(window); });
+            glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int, int) { on_input(window); });
+            glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) { on_input(window); });
         }
 
         /**
@@ -146,8 +257,9 @@ namespace gui
         /**
          * @brief Main loop of the GUI application.
          *
-         * Enters the main loop where events are polled, ImGui frames are started,
-         * and rendering is performed until the window is closed.
+         * Enters the main loop where events are waited for, ImGui frames are started,
+         * and rendering is performed until the window is closed. Frames are only drawn
+         * when there is something new to show (see wait_events), an idle window sleeps.
          */
         void run()
         {
@@ -156,8 +268,8 @@ namespace gui
             // Main loop
             while (!glfwWindowShouldClose(m_window))
             {
-                // Poll events and handle window close
-                glfwPollEvents();
+                // Wait for events and handle window close
+                wait_events();
                 if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
                 {
                     glfwSetWindowShouldClose(m_window, true);
@@ -184,6 +296,55 @@ namespace gui
             }
         }
 
+        /**
+         * @brief Waits until the next frame is due.
+         *
+         * For settle_seconds after an input the frames follow the display, so hover
+         * highlights, tooltip delays and double clicks work as usual. After that the loop
+         * sleeps until the next input, waking at the progress refresh rate while the
+         * derived class is busy (a job is running) and at the cursor blink while a text
+         * field has the keyboard. A job that ends while the loop sleeps has to wake it with
+         * glfwPostEmptyEvent, or its last state stays on screen until the next input.
+         */
+        void wait_events()
+        {
+            if (glfwGetTime() - m_last_input < settle_seconds)
+            {
+                glfwPollEvents();
+            }
+            else if (busy())
+            {
+                glfwWaitEventsTimeout(1.0 / m_refresh_rate);
+            }
+            else if (ImGui::GetIO().WantTextInput)
+            {
+                glfwWaitEventsTimeout(cursor_blink_seconds);
+            }
+            else
+            {
+                glfwWaitEvents();
+            }
+        }
+
+        /**
+         * @brief Sets how many times a second the window is redrawn while busy() is true.
+         */
+        void set_refresh_rate(double refresh_rate)
+        {
+            m_refresh_rate = std::max(1.0, refresh_rate);
+        }
+
+        /**
+         * @brief Function called to check whether the GUI shows something that changes without input.
+         *
+         * This function should be implemented in the derived class, e.g. to return
+         * true while a job is running.
+         */
+        bool busy()
+        {
+            return static_cast<DerivedClass*>(this)->busy();
+        }
+
         /**
          * @brief Function called to update the GUI application state.
          *
@@ -207,5 +368,20 @@ namespace gui
         }
 
         GLFWwindow* m_window{}; ///< Pointer to the GLFW window object.
+
+    private:
+        /**
+         * @brief Records the time of an input, see wait_events.
+         */
+        static void on_input(GLFWwindow* window)
+        {
+            static_cast<GuiApp*>(glfwGetWindowUserPointer(window))->m_last_input = glfwGetTime();
+        }
+
+        static constexpr double settle_seconds{ 0.5 };          ///< Frames keep following the display this long after an input.
+        static constexpr double cursor_blink_seconds{ 0.4 };    ///< Redraw interval of a blinking text cursor.
+
+        double m_last_input{};                          ///< glfwGetTime() of the last input, the first frames settle too.
+        double m_refresh_rate{ 10.0 };                  ///< Frames per second while busy.
     };
 }
\ No newline at end of file